@@ -4,6 +4,9 @@ export PATH=$HOME/.platformio/penv/bin:$PATH
 
 echo "Building MCU sources"
 
+# compressed FT812 assets must match bitmaps.h
+python3 tools/ft_assets.py verify src/bitmaps.h src/bitmaps_z.h || exit 1
+
 BUILD_VER=`date +%y%m%d%H`
 echo "Build version: $BUILD_VER"
 
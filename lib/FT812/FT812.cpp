@@ -68,6 +68,12 @@
 #define LOADIMAGE()                  0xFFFFFF24                                                                                                                             ///< Load image data
 #define MEDIAFIFO()                  0xFFFFFF39                                                                                                                             ///< Set up media FIFO in general purpose graphics RAM
 #define ROMFONT()                    0xFFFFFF3F   
+#define INFLATE()                    0xFFFFFF22  ///< Decompress zlib data to memory
+#define MEMCPY()                     0xFFFFFF1D  ///< Copy a block of memory
+#define MEMCRC()                     0xFFFFFF18  ///< Compute a CRC-32 of a block of memory
+#define APPEND()                     0xFFFFFF1E  ///< Append memory to the display list
+#define SAVE_CONTEXT()               (0x22L << 24)  ///< Push the graphics context
+#define RESTORE_CONTEXT()            (0x23L << 24)  ///< Pop the graphics context
 #define LOGO()                       0xffffff31                                                                                                                          ///< Load a ROM font into bitmap handle
 
 // KTOME addition
@@ -117,6 +123,7 @@ const ft_mode_t ft_modes[] =
 void FT812::begin(m_cb act)
 {
     action = act;
+    gramClear();
     pinMode(pin_cs, OUTPUT); digitalWrite(pin_cs, HIGH);
     if (has_reset) {
         pinMode(pin_reset, OUTPUT); digitalWrite(pin_reset, HIGH);
@@ -164,6 +171,9 @@ void FT812::reset()
         ctrl_reg = bitWrite(ctrl_reg, 4, 0);
         action(CMD_SPI_CONTROL, ADDR_CONTROL_REGISTER, ctrl_reg);
     }
+    // GRAM content is undefined after a hard reset
+    gramClear();
+    audio_pending = false;
     // disable mcu-ft spi
     spi(false);
     // disable ft vga switch
@@ -176,6 +186,13 @@ bool FT812::init(uint8_t m) {
 
     mode = ft_modes[m];
 
+    // chip is reset below, start over from the safe clock and an unknown fifo state
+    spi_clock = FT81x_SPI_CLOCK_SPEED;
+    cmd_len = 0;
+    cmd_space = 0;
+    cmd_fault = false;
+    frame_pending = false;
+
     sendCommand(FT81x_CMD_PWRDOWN);
     sendCommand(FT81x_CMD_ACTIVE);
     sendCommand(FT81x_CMD_SLEEP);
@@ -224,9 +241,41 @@ bool FT812::init(uint8_t m) {
     write8(FT81x_REG_INT_MASK, 1); // FT_INT_SWAP=1
     write8(FT81x_REG_INT_EN, 1);
 
+    negotiateClock();
+
+    // whether GRAM survives PWRDOWN depends on the chip, keep only resources with an unchanged crc
+    gramValidate();
+
     return true;
 }
 
+bool FT812::probe() {
+    // id register and a write / read back of the last GRAM word,
+    // which lies in the media fifo area and never holds a resource
+    const uint32_t addr = FT81x_RAM_G + FT81x_GRAM_SIZE - 4;
+    if (read8(FT81x_REG_ID) != 0x7C) return false;
+    write32(addr, 0x5AA5C33C);
+    if (read32(addr) != 0x5AA5C33C) return false;
+    write32(addr, 0xA55A3CC3);
+    return read32(addr) == 0xA55A3CC3;
+}
+
+void FT812::negotiateClock() {
+    // the bus is routed through the fpga, so the fast clock is kept only
+    // when the chip answers reliably with it
+    spi_clock = FT81x_SPI_FAST_CLOCK_SPEED;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!probe()) {
+            spi_clock = FT81x_SPI_CLOCK_SPEED;
+            return;
+        }
+    }
+}
+
+uint32_t FT812::spiClock() {
+  return spi_clock;
+}
+
 uint16_t FT812::width() {
   return mode.h_visible;
 }
@@ -496,14 +545,14 @@ void FT812::drawProgressbar(const int16_t x, const int16_t y, const int16_t widt
     endCmd(range);
 }
 
-void FT812::loadImage(const uint32_t offset, const uint32_t size, const uint8_t *data, const bool useProgmem) {
-    waitForCommandBuffer();
+bool FT812::loadImage(const uint32_t offset, const uint32_t size, const uint8_t *data, const bool useProgmem) {
+    if (!waitForCommandBuffer()) return false;
 
     startCmd(MEDIAFIFO());
     intermediateCmd(FT81x_RAM_G + 0x100000 - size);
     endCmd(size);
 
-    waitForCommandBuffer();
+    if (!waitForCommandBuffer()) return false;
 
     writeGRAM(0x100000 - size, size, data, useProgmem);
 
@@ -512,6 +561,13 @@ void FT812::loadImage(const uint32_t offset, const uint32_t size, const uint8_t
     startCmd(LOADIMAGE());
     intermediateCmd(FT81x_RAM_G + offset);
     endCmd(16 | 2);  // OPT_MEDIAFIFO | OPT_NODL
+    return !cmd_fault;
+}
+
+bool FT812::inflate(const uint32_t offset, const uint32_t size, const uint8_t *data) {
+    startCmd(INFLATE());
+    endCmd(FT81x_RAM_G + offset);
+    return cmdData(data, size);
 }
 
 void FT812::playAudio(const uint32_t offset, const uint32_t size, const uint16_t sampleRate, const uint8_t format, const bool loop) {
@@ -523,11 +579,29 @@ void FT812::playAudio(const uint32_t offset, const uint32_t size, const uint16_t
     write8(FT81x_REG_PLAYBACK_PLAY, 1);
 }
 
+void FT812::playClip(const uint32_t offset, const uint32_t size, const uint16_t sampleRate, const uint8_t format, const uint32_t duration) {
+    playAudio(offset, size, sampleRate, format, false);
+    audio_started = millis();
+    audio_duration = duration;
+    audio_pending = true;
+}
+
+bool FT812::isClipPlaying() {
+    return audio_pending;
+}
+
+void FT812::tick() {
+    if (!audio_pending || millis() - audio_started < audio_duration) return;
+    audio_pending = false;
+    // the chip may have been taken off the mcu bus (core switch), it is reset before the next use anyway
+    if (bitRead(ctrl_reg, 0)) {
+        stopSound();
+    }
+}
+
 void FT812::cmd(const uint32_t cmd) {
-    uint16_t cmdWrite = FT812::read16(FT81x_REG_CMD_WRITE);
-    uint32_t addr = FT81x_RAM_CMD + cmdWrite;
-    write32(addr, cmd);
-    write16(FT81x_REG_CMD_WRITE, (cmdWrite + 4) % 4096);
+    cmdPut(cmd);
+    cmdFlush();
 }
 
 void FT812::beginDisplayList() {
@@ -536,16 +610,74 @@ void FT812::beginDisplayList() {
     endCmd(CLEAR(1, 1, 1));
 }
 
-void FT812::swapScreen() {
+void FT812::beginDisplayList(const uint32_t offset, const uint32_t size) {
+    waitForCommandBuffer();
+    startCmd(DLSTART());
+    intermediateCmd(APPEND());
+    intermediateCmd(FT81x_RAM_G + offset);
+    endCmd(size);
+}
+
+uint32_t FT812::captureDisplayList(const uint32_t offset) {
+    // the co-processor must have emitted everything before REG_CMD_DL is valid
+    if (!waitForCommandBuffer()) return 0;
+    uint32_t size = read16(FT81x_REG_CMD_DL);
+    startCmd(MEMCPY());
+    intermediateCmd(FT81x_RAM_G + offset);
+    intermediateCmd(FT81x_RAM_DL);
+    endCmd(size);
+    return size;
+}
+
+void FT812::saveContext() {
+    cmd(SAVE_CONTEXT());
+}
+
+void FT812::restoreContext() {
+    cmd(RESTORE_CONTEXT());
+}
+
+bool FT812::swapScreen() {
     startCmd(END_DL());
     endCmd(SWAP());
+    if (cmd_fault) {
+        // the frame is lost, the next one starts on a restarted co-processor
+        recover();
+        return false;
+    }
+    frame_pending = true;
+    return true;
 }
 
-void FT812::waitForCommandBuffer() {
-    // Wait for circular buffer to catch up
-    while (read16(FT81x_REG_CMD_WRITE) != read16(FT81x_REG_CMD_READ)) {
-        __asm__ volatile("nop");
-    }
+bool FT812::waitForCommandBuffer() {
+    if (cmd_fault || !cmdReserve(FT81x_CMD_FIFO_SPACE)) return false;
+    frame_pending = false;
+    return true;
+}
+
+// co-processor fault recovery as in the FT81x programming guide: the
+// graphics engine is held in reset while the fifo pointers are cleared,
+// GRAM and the resources in it are kept
+void FT812::recover() {
+    write8(FT81x_REG_CPURESET, 1);
+    write16(FT81x_REG_CMD_READ, 0);
+    write16(FT81x_REG_CMD_WRITE, 0);
+    write16(FT81x_REG_CMD_DL, 0);
+    write8(FT81x_REG_CPURESET, 0);
+    cmd_len = 0;
+    cmd_space = 0;
+    cmd_fault = false;
+    frame_pending = false;
+}
+
+bool FT812::isIdle() {
+    cmd_space = read16(FT81x_REG_CMDB_SPACE) & 0xFFC;
+    return cmd_space == FT81x_CMD_FIFO_SPACE;
+}
+
+bool FT812::frameDone() {
+    if (frame_pending && isIdle()) frame_pending = false;
+    return !frame_pending;
 }
 
 void FT812::setRotation(const uint8_t rotation) { write8(FT81x_REG_ROTATE, rotation & 0x7); }
@@ -572,9 +704,146 @@ void FT812::stopSound() {
     playSound();
 }
 
-inline void FT812::increaseCmdWriteAddress(uint16_t delta) { cmdWriteAddress = (cmdWriteAddress + delta) % 4096; }
+/**************************************************************************************************/
+
+// GRAM resources: a small table of resident blobs (id, version, offset, size),
+// first fit below the media fifo area, least recently used eviction.
+// Residency survives init() as long as the signature words still read back.
+
+ft_gram_res_t* FT812::gramFind(uint16_t id) {
+    for (uint8_t i = 0; i < FT81x_GRAM_MAX_RES; i++) {
+        if (gram[i].id == id) return &gram[i];
+    }
+    return nullptr;
+}
+
+bool FT812::gramFit(uint32_t size, uint32_t &offset) {
+    // lowest gap after each resource (or at 0) that is not overlapped by another one
+    for (int8_t i = -1; i < FT81x_GRAM_MAX_RES; i++) {
+        if (i >= 0 && gram[i].id == 0) continue;
+        uint32_t start = (i < 0) ? 0 : (gram[i].offset + gram[i].size + 7) & ~7UL;
+        uint32_t end = start + size;
+        if (end > FT81x_GRAM_SIZE - FT81x_GRAM_FIFO_SIZE) continue;
+        bool overlap = false;
+        for (uint8_t j = 0; j < FT81x_GRAM_MAX_RES; j++) {
+            if (gram[j].id != 0 && start < gram[j].offset + gram[j].size && gram[j].offset < end) {
+                overlap = true;
+                break;
+            }
+        }
+        if (!overlap) {
+            offset = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FT812::gramCrc(const uint32_t offset, const uint32_t size, uint32_t &crc) {
+    if (!waitForCommandBuffer()) return false;
+    startCmd(MEMCRC());
+    intermediateCmd(FT81x_RAM_G + offset);
+    intermediateCmd(size);
+    endCmd(0);  // result slot
+    if (!waitForCommandBuffer()) return false;
+    // the co-processor writes the result over the last word of the command
+    uint16_t wp = read16(FT81x_REG_CMD_WRITE) & 0xFFF;
+    crc = read32(FT81x_RAM_CMD + ((wp - 4) & 0xFFF));
+    return true;
+}
+
+void FT812::gramCommit(ft_gram_res_t *r) {
+    r->valid = gramCrc(r->offset, r->size, r->crc);
+}
+
+bool FT812::gramLookup(const uint16_t id, const uint16_t version, uint32_t &offset) {
+    ft_gram_res_t *r = gramFind(id);
+    if (r == nullptr || !r->valid || r->version != version) return false;
+    r->used = ++gram_tick;
+    offset = r->offset;
+    return true;
+}
+
+uint32_t FT812::gramAlloc(const uint16_t id, const uint16_t version, const uint32_t size) {
+    ft_gram_res_t *r = gramFind(id);
+    if (r != nullptr) r->id = 0;
+
+    uint32_t offset = 0;
+    while (!gramFit(size, offset)) {
+        // evict the least recently used resource
+        ft_gram_res_t *lru = nullptr;
+        for (uint8_t i = 0; i < FT81x_GRAM_MAX_RES; i++) {
+            if (gram[i].id != 0 && (lru == nullptr || gram[i].used < lru->used)) lru = &gram[i];
+        }
+        if (lru == nullptr) break; // bigger than GRAM, let it overwrite from 0
+        lru->id = 0;
+    }
+
+    r = gramFind(0);
+    if (r == nullptr) {
+        // table is full, reuse the least recently used slot
+        r = &gram[0];
+        for (uint8_t i = 1; i < FT81x_GRAM_MAX_RES; i++) {
+            if (gram[i].used < r->used) r = &gram[i];
+        }
+    }
+    *r = {id, version, offset, size, 0, ++gram_tick, false};
+    return offset;
+}
+
+void FT812::gramCommit(const uint16_t id) {
+    ft_gram_res_t *r = gramFind(id);
+    if (r != nullptr) gramCommit(r);
+}
+
+uint32_t FT812::gramWrite(const uint16_t id, const uint16_t version, const uint32_t size, const uint8_t data[]) {
+    uint32_t offset;
+    if (gramLookup(id, version, offset)) return offset;
+    offset = gramAlloc(id, version, size);
+    writeGRAM(offset, size, data);
+    gramCommit(gramFind(id));
+    return offset;
+}
+
+uint32_t FT812::gramImage(const uint16_t id, const uint16_t version, const uint32_t bitmapSize, const uint32_t size, const uint8_t data[]) {
+    uint32_t offset;
+    if (gramLookup(id, version, offset)) return offset;
+    offset = gramAlloc(id, version, bitmapSize);
+    // crc is taken over the decoded bitmap; a resource that did not make it stays uncommitted and is uploaded again next time
+    if (loadImage(offset, size, data, false) && waitForCommandBuffer()) {
+        gramCommit(gramFind(id));
+    }
+    return offset;
+}
 
-inline void FT812::updateCmdWriteAddress() { write16(FT81x_REG_CMD_WRITE, cmdWriteAddress); }
+uint32_t FT812::gramInflate(const uint16_t id, const uint16_t version, const uint32_t rawSize, const uint32_t size, const uint8_t data[]) {
+    uint32_t offset;
+    if (gramLookup(id, version, offset)) return offset;
+    offset = gramAlloc(id, version, rawSize);
+    if (inflate(offset, size, data) && waitForCommandBuffer()) {
+        gramCommit(gramFind(id));
+    }
+    return offset;
+}
+
+void FT812::gramValidate() {
+    for (uint8_t i = 0; i < FT81x_GRAM_MAX_RES; i++) {
+        ft_gram_res_t *r = &gram[i];
+        if (r->id == 0) continue;
+        uint32_t crc;
+        if (!r->valid || !gramCrc(r->offset, r->size, crc) || crc != r->crc) {
+            r->id = 0;
+        }
+    }
+}
+
+void FT812::gramClear() {
+    for (uint8_t i = 0; i < FT81x_GRAM_MAX_RES; i++) {
+        gram[i].id = 0;
+    }
+}
+
+/**************************************************************************************************/
 
 void FT812::sendText(const char text[]) {
     uint32_t data = 0xFFFFFFFF;
@@ -621,165 +890,168 @@ uint8_t FT812::initBitmapHandleForFont(uint8_t font) {
 
 void FT812::writeGRAM(const uint32_t offset, const uint32_t size, const uint8_t *data, const bool useProgmem) {
     uint32_t cmd = (FT81x_RAM_G + offset) | WRITE;
+    uint8_t hdr[3] = {(uint8_t)(cmd >> 16), (uint8_t)(cmd >> 8), (uint8_t)cmd};
 
     SPI.beginTransaction(FT81x_SPI_SETTINGS);
     digitalWrite(pin_cs, LOW);
 
-    SPI.transfer((cmd >> 16) & 0xFF);
-    SPI.transfer((cmd >> 8) & 0xFF);
-    SPI.transfer(cmd & 0xFF);
+    SPI.transfer(hdr, nullptr, sizeof(hdr));
 
     if (useProgmem) {
-        for (uint32_t i = 0; i < size; i++) {
-            SPI.transfer(DATA(data, i));
+        uint8_t chunk[FT81x_GRAM_CHUNK];
+        for (uint32_t i = 0; i < size; i += sizeof(chunk)) {
+            uint32_t n = min(size - i, (uint32_t) sizeof(chunk));
+            memcpy_P(chunk, data + i, n);
+            SPI.transfer(chunk, nullptr, n);
         }
     } else {
-        for (uint32_t i = 0; i < size; i++) {
-            SPI.transfer(data[i]);
-        }
+        SPI.transfer(data, nullptr, size);
     }
 
     digitalWrite(pin_cs, HIGH);
     SPI.endTransaction();
 }
 
-void FT812::startCmd(const uint32_t cmd) {
-    uint32_t addr = (FT81x_RAM_CMD + cmdWriteAddress) | WRITE;
+// Command words are staged in cmd_buf and appended to the co-processor fifo
+// through REG_CMDB_WRITE in bulk. The free space is only read back from
+// REG_CMDB_SPACE when the cached value says the fifo may be full. A write
+// that finds no space within FT81x_CMD_TIMEOUT is dropped and marks a fault,
+// after which nothing goes into the fifo until recover().
+
+bool FT812::cmdReserve(const uint16_t size) {
+    if (cmd_space >= size) return true;
+    cmd_timer.reset();
+    for (;;) {
+        cmd_space = read16(FT81x_REG_CMDB_SPACE) & 0xFFC;
+        if (cmd_space >= size) return true;
+        if (cmd_timer.elapsed() > FT81x_CMD_TIMEOUT) return false;
+    }
+}
+
+void FT812::cmdPut(const uint32_t cmd) {
+    if (cmd_len + 4 > sizeof(cmd_buf)) cmdFlush();
+    cmd_buf[cmd_len++] = cmd;
+    cmd_buf[cmd_len++] = cmd >> 8;
+    cmd_buf[cmd_len++] = cmd >> 16;
+    cmd_buf[cmd_len++] = cmd >> 24;
+}
+
+bool FT812::cmdWrite(const uint8_t *data, const uint16_t size) {
+    // the fifo may hold part of a command by now, more words would only be misparsed
+    if (cmd_fault || !cmdReserve(size)) {
+        cmd_fault = true;
+        return false;
+    }
 
+    uint32_t addr = FT81x_REG_CMDB_WRITE | WRITE;
+    uint8_t hdr[3] = {(uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
     SPI.beginTransaction(FT81x_SPI_SETTINGS);
     digitalWrite(pin_cs, LOW);
+    SPI.transfer(hdr, nullptr, sizeof(hdr));
+    SPI.transfer(data, nullptr, size);
+    digitalWrite(pin_cs, HIGH);
+    SPI.endTransaction();
 
-    SPI.transfer(addr >> 16);
-    SPI.transfer(addr >> 8);
-    SPI.transfer(addr);
-    SPI.transfer(cmd);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 24);
+    cmd_space = (cmd_space > size) ? cmd_space - size : 0;
+    return true;
+}
 
-    increaseCmdWriteAddress(4);
+bool FT812::cmdFlush() {
+    if (cmd_len == 0) return !cmd_fault;
+    bool ok = cmdWrite(cmd_buf, cmd_len);
+    cmd_len = 0;
+    return ok;
 }
 
-void FT812::intermediateCmd(const uint32_t cmd) {
+bool FT812::cmdData(const uint8_t *data, const uint32_t size) {
+    // inline data of the last command, in chunks that fit the fifo, padded to 4 bytes
+    if (!cmdFlush()) return false;
+    uint32_t pos = 0;
+    while (size - pos >= 4) {
+        uint16_t n = min(size - pos, (uint32_t) FT81x_CMD_CHUNK) & ~3;
+        if (!cmdWrite(data + pos, n)) return false;
+        pos += n;
+    }
+    if (pos < size) {
+        uint8_t pad[4] = {0, 0, 0, 0};
+        memcpy(pad, data + pos, size - pos);
+        return cmdWrite(pad, sizeof(pad));
+    }
+    return true;
+}
 
-    SPI.transfer(cmd);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 24);
+void FT812::startCmd(const uint32_t cmd) {
+    cmdPut(cmd);
+}
 
-    increaseCmdWriteAddress(4);
+void FT812::intermediateCmd(const uint32_t cmd) {
+    cmdPut(cmd);
 }
 
 void FT812::endCmd(const uint32_t cmd) {
-
-    SPI.transfer(cmd);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 24);
-
-    digitalWrite(pin_cs, HIGH);
-    SPI.endTransaction();
-
-    increaseCmdWriteAddress(4);
-
-    updateCmdWriteAddress();
+    cmdPut(cmd);
+    cmdFlush();
 }
 
 void FT812::sendCommand(const uint32_t cmd) {
 
+    uint8_t buf[3] = {(uint8_t)(cmd >> 16), (uint8_t)(cmd >> 8), (uint8_t)cmd};
     SPI.beginTransaction(FT81x_SPI_LOW_SETTINGS);
     digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    uint8_t res = SPI.transfer(cmd);
+    SPI.transfer(buf, nullptr, sizeof(buf));
     digitalWrite(pin_cs, HIGH);
     SPI.endTransaction();
-    //delay(200);
-    //Serial.printf("Command %d result %d", cmd, res); Serial.println();
 }
 
-uint8_t FT812::read8(const uint32_t address) {
+// register reads: 3 address bytes, a dummy byte, then the value (little endian)
+
+uint32_t FT812::read(const uint32_t address, const uint8_t len) {
     uint32_t cmd = address | READ;
+    uint8_t tx[8] = {(uint8_t)(cmd >> 16), (uint8_t)(cmd >> 8), (uint8_t)cmd, 0, 0, 0, 0, 0};
+    uint8_t rx[8];
     SPI.beginTransaction(FT81x_SPI_SETTINGS);
     digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(0x00);  // dummy byte
-    uint8_t result = SPI.transfer(0x00);
+    SPI.transfer(tx, rx, 4 + len);
     digitalWrite(pin_cs, HIGH);
     SPI.endTransaction();
+    uint32_t result = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        result |= (uint32_t)rx[4 + i] << (i * 8);
+    }
     return result;
 }
 
-uint16_t FT812::read16(const uint32_t address) {
-    uint32_t cmd = address | READ;
+void FT812::write(const uint32_t address, const uint32_t data, const uint8_t len) {
+    uint32_t cmd = address | WRITE;
+    uint8_t tx[7] = {(uint8_t)(cmd >> 16), (uint8_t)(cmd >> 8), (uint8_t)cmd,
+      (uint8_t)data, (uint8_t)(data >> 8), (uint8_t)(data >> 16), (uint8_t)(data >> 24)};
     SPI.beginTransaction(FT81x_SPI_SETTINGS);
     digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(0x00);  // dummy byte
-    uint16_t result = SPI.transfer(0x00);
-    result |= (SPI.transfer(0x00) << 8);
+    SPI.transfer(tx, nullptr, 3 + len);
     digitalWrite(pin_cs, HIGH);
     SPI.endTransaction();
-    return result;
+}
+
+uint8_t FT812::read8(const uint32_t address) {
+    return read(address, 1);
+}
+
+uint16_t FT812::read16(const uint32_t address) {
+    return read(address, 2);
 }
 
 uint32_t FT812::read32(const uint32_t address) {
-    uint32_t cmd = address | READ;
-    SPI.beginTransaction(FT81x_SPI_SETTINGS);
-    digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(0x00);  // dummy byte
-    uint32_t result = SPI.transfer(0x00);
-    result |= (SPI.transfer(0x00) << 8);
-    result |= ((uint32_t)SPI.transfer(0x00) << 16);
-    result |= ((uint32_t)SPI.transfer(0x00) << 24);
-    digitalWrite(pin_cs, HIGH);
-    SPI.endTransaction();
-    return result;
+    return read(address, 4);
 }
 
 void FT812::write8(const uint32_t address, const uint8_t data) {
-    uint32_t cmd = address | WRITE;
-    SPI.beginTransaction(FT81x_SPI_SETTINGS);
-    digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(data);
-    digitalWrite(pin_cs, HIGH);
-    SPI.endTransaction();
+    write(address, data, 1);
 }
 
 void FT812::write16(const uint32_t address, const uint16_t data) {
-    uint32_t cmd = address | WRITE;
-    SPI.beginTransaction(FT81x_SPI_SETTINGS);
-    digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(data);
-    SPI.transfer(data >> 8);
-    digitalWrite(pin_cs, HIGH);
-    SPI.endTransaction();
+    write(address, data, 2);
 }
 
 void FT812::write32(const uint32_t address, const uint32_t data) {
-    uint32_t cmd = address | WRITE;
-    SPI.beginTransaction(FT81x_SPI_SETTINGS);
-    digitalWrite(pin_cs, LOW);
-    SPI.transfer(cmd >> 16);
-    SPI.transfer(cmd >> 8);
-    SPI.transfer(cmd);
-    SPI.transfer(data);
-    SPI.transfer(data >> 8);
-    SPI.transfer(data >> 16);
-    SPI.transfer(data >> 24);
-    digitalWrite(pin_cs, HIGH);
-    SPI.endTransaction();
+    write(address, data, 4);
 }
@@ -48,9 +48,19 @@
 
 #define FT81x_SPI_CLOCK_SPEED 12000000  ///< FT SPI clock speed
 #define FT81x_SPI_LOW_CLOCK_SPEED 1000000  ///< FT SPI low clock speed
+#define FT81x_SPI_FAST_CLOCK_SPEED 30000000  ///< FT SPI clock speed tried after init (FT81x maximum)
+#define FT81x_CMD_BUF_SIZE 64  ///< Command buffer bulk-write staging size, bytes
+#define FT81x_CMD_FIFO_SPACE 4092  ///< REG_CMDB_SPACE value of an empty co-processor fifo
+#define FT81x_CMD_TIMEOUT 200  ///< Max wait for co-processor fifo space, ms
+#define FT81x_CMD_CHUNK 1024  ///< Max inline data written to the co-processor fifo at once, bytes
+#define FT81x_GRAM_CHUNK 512  ///< GRAM bulk-write staging size for PROGMEM sources, bytes
+#define FT81x_GRAM_SIZE 0x100000  ///< General purpose graphics RAM size
+#define FT81x_GRAM_FIFO_SIZE 0x10000  ///< Top of GRAM kept for the media fifo and the clock probe, not allocated
+#define FT81x_GRAM_MAX_RES 8  ///< Max resident GRAM resources
+#define FT81x_DL_SIZE 8192  ///< Display list RAM size
 
 #ifndef FT81x_SPI_SETTINGS
-#define FT81x_SPI_SETTINGS SPISettings(FT81x_SPI_CLOCK_SPEED, MSBFIRST, SPI_MODE0)  ///< Default SPI settings, can be overwritten
+#define FT81x_SPI_SETTINGS SPISettings(spi_clock, MSBFIRST, SPI_MODE0)  ///< Default SPI settings (negotiated clock), can be overwritten
 #endif
 
 #ifndef FT81x_SPI_LOW_SETTINGS
@@ -246,6 +256,17 @@ typedef struct
   uint16_t v_visible;  // Vertical visible area size
 } ft_mode_t;
 
+typedef struct
+{
+  uint16_t id;         // resource id, 0 = free slot
+  uint16_t version;    // resource version, a mismatch forces a re-upload
+  uint32_t offset;     // offset in GRAM
+  uint32_t size;       // allocated size in GRAM
+  uint32_t crc;        // CMD_MEMCRC of the whole resource after upload
+  uint32_t used;       // lru stamp
+  bool valid;          // upload committed
+} ft_gram_res_t;
+
 class FT812
 {
 
@@ -258,10 +279,35 @@ private:
   uint8_t pin_reset;                 ///< RESET pin for FT81x
   bool has_reset;
   ElapsedTimer init_timer;
-
-protected:
-
-  uint16_t cmdWriteAddress = 0;  ///< Internal pointer to the command buffer of the FT81x chip
+  ElapsedTimer cmd_timer;
+  uint32_t spi_clock = FT81x_SPI_CLOCK_SPEED;
+  uint8_t cmd_buf[FT81x_CMD_BUF_SIZE];
+  uint8_t cmd_len = 0;
+  uint16_t cmd_space = 0;         // free co-processor fifo bytes as last read, minus what was written since
+  bool cmd_fault = false;         // a fifo write timed out and was dropped, see recover()
+  bool frame_pending = false;     // swapScreen() was queued and the fifo has not drained yet
+  bool audio_pending = false;     // a clip is playing and has to be stopped by tick()
+  uint32_t audio_started;         // millis() when the clip started
+  uint32_t audio_duration;        // clip length, ms
+
+  bool cmdReserve(const uint16_t size);
+  bool cmdWrite(const uint8_t *data, const uint16_t size);
+  bool cmdData(const uint8_t *data, const uint32_t size);
+
+  void cmdPut(const uint32_t cmd);
+  uint32_t read(const uint32_t address, const uint8_t len);
+  void write(const uint32_t address, const uint32_t data, const uint8_t len);
+  bool cmdFlush();
+  bool probe();
+  void negotiateClock();
+
+  ft_gram_res_t gram[FT81x_GRAM_MAX_RES];
+  uint32_t gram_tick = 0;
+
+  ft_gram_res_t* gramFind(uint16_t id);
+  bool gramFit(uint32_t size, uint32_t &offset);
+  bool gramCrc(const uint32_t offset, const uint32_t size, uint32_t &crc);
+  void gramCommit(ft_gram_res_t *r);
 
 public:
 
@@ -283,6 +329,12 @@ public:
     */
     uint16_t height();
 
+    /*!
+        @brief  Get the negotiated SPI clock
+        @return SPI clock in Hz
+    */
+    uint32_t spiClock();
+
     /*!
         @brief  Write single command to the command buffer of the FT81x chip
         @param  cmd 8-bit command to send to the chip
@@ -307,16 +359,6 @@ public:
     */
     void endCmd(const uint32_t cmd);
 
-    /*!
-        @brief  Increase the internal pointer to the command buffer
-        @param  delta Amount to increase the pointer by
-    */
-    void increaseCmdWriteAddress(uint16_t delta);
-
-    /*!
-        @brief  Write the internal pointer to the command buffer to the FT81x chip
-    */
-    void updateCmdWriteAddress();
 
     /*!
         @brief  Send text as the end of a command sequence
@@ -642,15 +684,58 @@ public:
     */
     void beginDisplayList();
 
+    /*!
+        @brief  Begin a new display list with a display list saved by captureDisplayList()
+        @param  offset Offset of the saved display list in general purpose graphics RAM
+        @param  size Size of the saved display list in bytes
+    */
+    void beginDisplayList(const uint32_t offset, const uint32_t size);
+
+    /*!
+        @brief  Copy the display list built so far to general purpose graphics RAM (up to 8 kBytes)
+        @param  offset Offset in general purpose graphics RAM
+        @return Size of the saved display list in bytes, 0 when the co-processor did not get there
+    */
+    uint32_t captureDisplayList(const uint32_t offset);
+
+    /*!
+        @brief  Push the current graphics context (colors, blending, bitmap transform)
+    */
+    void saveContext();
+
+    /*!
+        @brief  Pop the graphics context pushed by saveContext()
+    */
+    void restoreContext();
+
     /*!
         @brief  End the current display list and swap the screen
+        @return false when the frame was dropped on a co-processor fifo timeout, the co-processor is restarted then
     */
-    void swapScreen();
+    bool swapScreen();
 
     /*!
-        @brief  The command buffer can take 4 kBytes of data while display lists can hold 8 kBytes. For display lists > 4k and < 8k you may need to wait for the buffer to catch up.
+        @brief  Wait until the co-processor has executed everything queued so far (bounded by FT81x_CMD_TIMEOUT)
+        @return false on a timeout, or while a dropped fifo write has not been recovered from
     */
-    void waitForCommandBuffer();
+    bool waitForCommandBuffer();
+
+    /*!
+        @brief  Restart a hung co-processor with an empty command fifo, GRAM is kept
+    */
+    void recover();
+
+    /*!
+        @brief  Query whether the co-processor fifo is empty, without waiting
+        @return true when everything queued so far has been executed
+    */
+    bool isIdle();
+
+    /*!
+        @brief  Query whether the last frame queued by swapScreen() has been executed, without waiting
+        @return true when no frame is in flight
+    */
+    bool frameDone();
 
     /*!
         @brief  Set screen rotation
@@ -673,8 +758,18 @@ public:
         @param  size Size of the data in bytes
         @param  data Pointer to the data
         @param  useProgmem Load data from PROGMEM (only affects AVR architectures like the Arduino Uno)
+        @return false when the co-processor fifo timed out
+    */
+    bool loadImage(const uint32_t offset, const uint32_t size, const uint8_t data[], const bool useProgmem = true);
+
+    /*!
+        @brief  Decompress zlib data into general purpose graphics RAM with the co-processor
+        @param  offset Offset in general purpose graphics RAM
+        @param  size Size of the compressed data in bytes
+        @param  data Pointer to the compressed data
+        @return false when the co-processor fifo timed out
     */
-    void loadImage(const uint32_t offset, const uint32_t size, const uint8_t data[], const bool useProgmem = true);
+    bool inflate(const uint32_t offset, const uint32_t size, const uint8_t data[]);
 
     /*!
         @brief  Play audio data located in general purpose graphics RAM (must be aligned to 8 bytes)
@@ -686,6 +781,27 @@ public:
     */
     void playAudio(const uint32_t offset, const uint32_t size, const uint16_t sampleRate, const uint8_t format, const bool loop);
 
+    /*!
+        @brief  Play audio data like playAudio() and stop the sound output from tick() once the clip is over
+        @param  offset Offset in general purpose graphics RAM
+        @param  size Size of the data in bytes
+        @param  sampleRate Sample rate for the audio data (e.g. 44100)
+        @param  format Audio data format (e.g. FT81x_AUDIO_FORMAT_LINEAR)
+        @param  duration Clip length in ms
+    */
+    void playClip(const uint32_t offset, const uint32_t size, const uint16_t sampleRate, const uint8_t format, const uint32_t duration);
+
+    /*!
+        @brief  Query whether a clip started by playClip() is still playing
+        @return true while the clip is playing
+    */
+    bool isClipPlaying();
+
+    /*!
+        @brief  Run deferred work (clip stop), call from the main loop
+    */
+    void tick();
+
     /*!
         @brief  Query whether sound is currently playing
         @return true when sound is playing and false otherwise
@@ -715,6 +831,72 @@ public:
     */
     void stopSound();
 
+    /*!
+        @brief  Look up a resident GRAM resource
+        @param  id Resource id (non zero)
+        @param  version Resource version
+        @param  offset Receives the offset in GRAM
+        @return true when the resource is resident with the same version
+    */
+    bool gramLookup(const uint16_t id, const uint16_t version, uint32_t &offset);
+
+    /*!
+        @brief  Allocate GRAM for a resource, evicting least recently used ones when full
+        @param  id Resource id (non zero)
+        @param  version Resource version
+        @param  size Size in bytes
+        @return Offset in GRAM (8 bytes aligned)
+    */
+    uint32_t gramAlloc(const uint16_t id, const uint16_t version, const uint32_t size);
+
+    /*!
+        @brief  Mark a resource allocated by gramAlloc() as uploaded (wait for the co-processor first)
+        @param  id Resource id
+    */
+    void gramCommit(const uint16_t id);
+
+    /*!
+        @brief  Upload raw data (e.g. audio) to GRAM unless already resident
+        @param  id Resource id (non zero)
+        @param  version Resource version
+        @param  size Size of the data in bytes
+        @param  data Pointer to the data
+        @return Offset in GRAM
+    */
+    uint32_t gramWrite(const uint16_t id, const uint16_t version, const uint32_t size, const uint8_t data[]);
+
+    /*!
+        @brief  Decode an image (JPEG, PNG) to GRAM unless already resident
+        @param  id Resource id (non zero)
+        @param  version Resource version
+        @param  bitmapSize Size of the decoded bitmap in bytes
+        @param  size Size of the image data in bytes
+        @param  data Pointer to the image data
+        @return Offset in GRAM
+    */
+    uint32_t gramImage(const uint16_t id, const uint16_t version, const uint32_t bitmapSize, const uint32_t size, const uint8_t data[]);
+
+    /*!
+        @brief  Inflate zlib compressed data to GRAM unless already resident
+        @param  id Resource id (non zero)
+        @param  version Resource version
+        @param  rawSize Size of the decompressed data in bytes
+        @param  size Size of the compressed data in bytes
+        @param  data Pointer to the compressed data
+        @return Offset in GRAM
+    */
+    uint32_t gramInflate(const uint16_t id, const uint16_t version, const uint32_t rawSize, const uint32_t size, const uint8_t data[]);
+
+    /*!
+        @brief  Drop resources whose CMD_MEMCRC no longer matches the one taken at upload (after a chip reset)
+    */
+    void gramValidate();
+
+    /*!
+        @brief  Forget all resident resources
+    */
+    void gramClear();
+
 };
 
 #endif // __FT812_H__
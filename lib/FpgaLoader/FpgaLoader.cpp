@@ -0,0 +1,88 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#include <FpgaLoader.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include "fpga_conf.pio.h"
+
+FpgaLoader::FpgaLoader() : pgm(&fpga_conf_program)
+{
+  is_started = false;
+  dma_chan = -1;
+}
+
+bool FpgaLoader::begin(uint8_t data, uint8_t clk, uint32_t freq)
+{
+  if (is_started) end();
+
+  pin_data = data;
+  pin_clk = clk;
+
+  int offset;
+  if (!pgm.prepare(&pio, &sm, &offset)) {
+    return false;
+  }
+
+  // 2 PIO cycles per bit
+  float clkdiv = (float) clock_get_hz(clk_sys) / (freq * 2);
+  if (clkdiv < 1.0f) clkdiv = 1.0f;
+  fpga_conf_program_init(pio, sm, offset, clkdiv, pin_data, pin_clk);
+
+  dma_chan = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(dma_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+  // byte writes are replicated across the 32-bit FIFO word, so the
+  // shift-left OSR picks the byte up from the top bits as expected
+  dma_channel_configure(dma_chan, &c, &pio->txf[sm], NULL, 0, false);
+
+  is_started = true;
+  return true;
+}
+
+void FpgaLoader::write(const uint8_t* buf, size_t len)
+{
+  if (!is_started || len == 0) return;
+  dma_channel_wait_for_finish_blocking(dma_chan);
+  dma_channel_transfer_from_buffer_now(dma_chan, buf, len);
+}
+
+bool FpgaLoader::busy()
+{
+  return is_started && dma_channel_is_busy(dma_chan);
+}
+
+void FpgaLoader::wait()
+{
+  if (!is_started) return;
+  dma_channel_wait_for_finish_blocking(dma_chan);
+  // DMA is done when the last byte enters the FIFO, wait for the SM to drain it
+  uint32_t stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + sm);
+  pio->fdebug = stall_mask;
+  while (!pio_sm_is_tx_fifo_empty(pio, sm) || !(pio->fdebug & stall_mask)) {
+    tight_loop_contents();
+  }
+}
+
+void FpgaLoader::end()
+{
+  if (!is_started) return;
+  wait();
+  pio_sm_set_enabled(pio, sm, false);
+  pio_sm_unclaim(pio, sm);
+  dma_channel_unclaim(dma_chan);
+  dma_chan = -1;
+  pinMode(pin_clk, INPUT);
+  pinMode(pin_data, INPUT);
+  is_started = false;
+}
+
+// vim:cin:ai:sts=2 sw=2 ft=cpp
@@ -0,0 +1,70 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef __FPGA_LOADER_H__
+#define __FPGA_LOADER_H__
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+
+/****************************************************************************/
+
+/**
+ * Xilinx slave serial bitstream loader.
+ * A PIO state machine shifts DIN/CCLK, a DMA channel feeds it from
+ * caller-owned buffers, so the CPU is free to read the next chunk
+ * from SD while the previous one is being clocked out.
+ */
+
+class FpgaLoader
+{
+
+private:
+  PIOProgram pgm;
+  PIO pio;
+  int sm;
+  int dma_chan;
+  uint8_t pin_data;
+  uint8_t pin_clk;
+  bool is_started;
+
+public:
+
+  FpgaLoader();
+
+  /**
+   * Claim PIO SM and DMA channel, take over DIN and CCLK pins
+   */
+  bool begin(uint8_t data, uint8_t clk, uint32_t freq);
+
+  /**
+   * Start shifting out len bytes from buf.
+   * Waits for the previous transfer, so buf must stay untouched until
+   * the next write() or wait() call returns.
+   */
+  void write(const uint8_t* buf, size_t len);
+
+  /**
+   * True while DMA is still feeding the SM
+   */
+  bool busy();
+
+  /**
+   * Wait until all the queued bytes are clocked out
+   */
+  void wait();
+
+  /**
+   * Flush, release SM, DMA channel and pins (pins become inputs)
+   */
+  void end();
+
+};
+
+#endif // __FPGA_LOADER_H__
+// vim:cin:ai:sts=2 sw=2 ft=cpp
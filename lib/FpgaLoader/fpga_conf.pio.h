@@ -0,0 +1,57 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// --------- //
+// fpga_conf //
+// --------- //
+
+#define fpga_conf_wrap_target 0
+#define fpga_conf_wrap 1
+
+static const uint16_t fpga_conf_program_instructions[] = {
+            //     .wrap_target
+    0x6001, //  0: out    pins, 1         side 0     
+    0xb042, //  1: nop                    side 1     
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program fpga_conf_program = {
+    .instructions = fpga_conf_program_instructions,
+    .length = 2,
+    .origin = -1,
+};
+
+static inline pio_sm_config fpga_conf_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + fpga_conf_wrap_target, offset + fpga_conf_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+
+#include "hardware/gpio.h"
+static inline void fpga_conf_program_init(PIO pio, uint sm, uint offset, float clkdiv, uint pin_data, uint pin_clk) {
+    pio_sm_config c = fpga_conf_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_data, 1);
+    sm_config_set_sideset_pins(&c, pin_clk);
+    // MSB first, autopull every byte
+    sm_config_set_out_shift(&c, false, true, 8);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv(&c, clkdiv);
+    pio_sm_set_pins_with_mask(pio, sm, 0, (1u << pin_clk) | (1u << pin_data));
+    pio_sm_set_pindirs_with_mask(pio, sm, (1u << pin_clk) | (1u << pin_data), (1u << pin_clk) | (1u << pin_data));
+    pio_gpio_init(pio, pin_data);
+    pio_gpio_init(pio, pin_clk);
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif
+
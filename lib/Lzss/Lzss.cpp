@@ -0,0 +1,88 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#include "Lzss.h"
+#include <string.h>
+
+#define LZSS_WINDOW_MASK (Lzss::WINDOW_SIZE - 1)
+
+Lzss::Lzss()
+{
+  reset();
+}
+
+void Lzss::reset()
+{
+  memset(window, 0, sizeof(window));
+  wpos = 0;
+  flags = 0;
+  flag_bits = 0;
+  match_hi = 0;
+  has_match_hi = false;
+  match_dist = 0;
+  match_len = 0;
+}
+
+size_t Lzss::decode(const uint8_t *in, size_t in_len, size_t *in_used, uint8_t *out, size_t out_len)
+{
+  size_t in_pos = 0;
+  size_t out_pos = 0;
+
+  while (out_pos < out_len) {
+
+    // copy the rest of a pending match
+    if (match_len > 0) {
+      uint8_t b = window[(wpos - match_dist) & LZSS_WINDOW_MASK];
+      window[wpos] = b;
+      wpos = (wpos + 1) & LZSS_WINDOW_MASK;
+      out[out_pos++] = b;
+      match_len--;
+      continue;
+    }
+
+    if (in_pos == in_len) break;
+
+    // next flag byte
+    if (flag_bits == 0) {
+      flags = in[in_pos++];
+      flag_bits = 8;
+      continue;
+    }
+
+    if (flags & 1) {
+      // literal
+      uint8_t b = in[in_pos++];
+      window[wpos] = b;
+      wpos = (wpos + 1) & LZSS_WINDOW_MASK;
+      out[out_pos++] = b;
+    } else {
+      // match, the token may be split between two calls
+      if (!has_match_hi) {
+        match_hi = in[in_pos++];
+        has_match_hi = true;
+        if (in_pos == in_len) break;
+      }
+      uint8_t lo = in[in_pos++];
+      has_match_hi = false;
+      match_dist = (((uint16_t) match_hi << 4) | (lo >> 4)) + 1;
+      match_len = (lo & 0x0F) + MIN_MATCH;
+    }
+    flags >>= 1;
+    flag_bits--;
+  }
+
+  *in_used = in_pos;
+  return out_pos;
+}
+
+bool Lzss::idle() const
+{
+  return match_len == 0 && !has_match_hi;
+}
+
+// vim:cin:ai:sts=2 sw=2 ft=cpp
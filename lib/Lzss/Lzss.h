@@ -0,0 +1,69 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef __LZSS_H__
+#define __LZSS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/****************************************************************************/
+
+/**
+ * Streaming LZSS decoder for packed .kg sections (see tools/kgpack.py).
+ *
+ * Stream format: a flag byte describes the next 8 items, LSB first.
+ * Flag bit 1 - literal byte follows.
+ * Flag bit 0 - 2-byte match follows: DDDDDDDD DDDDLLLL,
+ *   distance = D + 1 (1..4096), length = L + 3 (3..18).
+ *
+ * No Arduino dependencies, so it can be built and tested on a host.
+ */
+
+class Lzss
+{
+
+public:
+  static const uint16_t WINDOW_SIZE = 4096;
+  static const uint8_t MIN_MATCH = 3;
+
+  Lzss();
+
+  /**
+   * Prepare for a new stream
+   */
+  void reset();
+
+  /**
+   * Decode as much as possible from in[0..in_len) into out[0..out_len).
+   * Returns the number of bytes produced, *in_used receives the number of
+   * input bytes consumed. Decoding can be resumed at any byte boundary
+   * of both input and output.
+   */
+  size_t decode(const uint8_t *in, size_t in_len, size_t *in_used, uint8_t *out, size_t out_len);
+
+  /**
+   * True when no match token or match copy is half done, so the stream
+   * may end here. False at the end of the input means it was truncated.
+   */
+  bool idle() const;
+
+private:
+  uint8_t window[WINDOW_SIZE];
+  uint16_t wpos;
+  uint8_t flags;
+  uint8_t flag_bits;
+  uint8_t match_hi;
+  bool has_match_hi;
+  uint16_t match_dist;
+  uint8_t match_len;
+
+};
+
+#endif // __LZSS_H__
+// vim:cin:ai:sts=2 sw=2 ft=cpp
@@ -9,6 +9,8 @@ MultiMatrixDisplay::MultiMatrixDisplay()
     
     _addresses = new uint8_t[totalMatrices];
     _matrices = new Adafruit_BicolorMatrix[totalMatrices];
+    _shadow = new uint16_t[totalMatrices * 8];
+    _synced = false;
     
     for (uint8_t i = 0; i < totalMatrices; i++) {
         _addresses[i] = 0x70 + i;
@@ -18,6 +20,7 @@ MultiMatrixDisplay::MultiMatrixDisplay()
 MultiMatrixDisplay::~MultiMatrixDisplay() {
     delete[] _addresses;
     delete[] _matrices;
+    delete[] _shadow;
 }
 
 bool MultiMatrixDisplay::begin() {
@@ -27,6 +30,7 @@ bool MultiMatrixDisplay::begin() {
         if (!_matrices[i].begin(_addresses[i]))
             result = false;
     }
+    _synced = false;
     return result;
 }
 
@@ -62,7 +66,45 @@ void MultiMatrixDisplay::drawPixel(int16_t x, int16_t y, uint16_t color) {
 void MultiMatrixDisplay::writeDisplay() {
     uint8_t totalMatrices = _wide * _high;
     for (uint8_t i = 0; i < totalMatrices; i++) {
-        _matrices[i].writeDisplay();
+        uint16_t* rows = _matrices[i].displaybuffer;
+        uint16_t* sent = &_shadow[i * 8];
+        uint8_t row = 0;
+        while (row < 8) {
+            if (_synced && rows[row] == sent[row]) {
+                row++;
+                continue;
+            }
+            // one transaction per run of changed rows
+            uint8_t first = row;
+            while (row < 8 && (!_synced || rows[row] != sent[row])) row++;
+            Wire.beginTransmission(_addresses[i]);
+            Wire.write(first * 2); // display ram address, 2 bytes per row
+            for (uint8_t r = first; r < row; r++) {
+                Wire.write(rows[r] & 0xFF);
+                Wire.write(rows[r] >> 8);
+                sent[r] = rows[r];
+            }
+            Wire.endTransmission();
+        }
+    }
+    _synced = true;
+}
+
+void MultiMatrixDisplay::invalidate() {
+    _synced = false;
+}
+
+void MultiMatrixDisplay::setBitplane(uint8_t index, uint8_t bits) {
+    uint8_t matrixIndex = index / 16;
+    if (matrixIndex >= _wide * _high) return;
+
+    uint8_t row = index % 8;
+    uint16_t* rows = _matrices[matrixIndex].displaybuffer;
+    // bicolor ht16k33 row: green pixels in the low byte, red in the high byte
+    if (index & 0x08) {
+        rows[row] = (rows[row] & 0xFF00) | bits;
+    } else {
+        rows[row] = (rows[row] & 0x00FF) | (bits << 8);
     }
 }
 
@@ -32,10 +32,23 @@ public:
     void drawPixel(int16_t x, int16_t y, uint16_t color) override;
 
     /**
-     * Send buffer to all ht16k33 chips at once.
+     * Send changed rows of the buffer to the ht16k33 chips.
      */
     void writeDisplay();
 
+    /**
+     * Force the next writeDisplay() to send all the rows.
+     */
+    void invalidate();
+
+    /**
+     * Set one row of one color plane, bit N is the column N of the matrix.
+     * @param index 0-7: matrix 1 red rows, 8-15: matrix 1 green rows,
+     *              16-23: matrix 2 red rows, 24-31: matrix 2 green rows, etc.
+     * @param bits Row pixels.
+     */
+    void setBitplane(uint8_t index, uint8_t bits);
+
     /**
      * Clear the virtual canvas.
      */
@@ -57,6 +70,8 @@ private:
     uint8_t _high;                  // Count of matricies (ver)
     uint8_t* _addresses;            // The array of connected i2c addresses of the matricies
     Adafruit_BicolorMatrix* _matrices;  // The array of connected bi-color matricies
+    uint16_t* _shadow;              // Rows last sent to the chips, 8 per matrix
+    bool _synced;                   // The shadow matches the chips
 };
 
 #endif // MULTI_MATRIX_DISPLAY_H
@@ -31,6 +31,11 @@ const uint8_t ADDR_SET_POS_Y = 0x11;
 const uint8_t ADDR_CHAR = 0x12;
 const uint8_t ADDR_ATTR = 0x13;
 const uint8_t ADDR_NOOP = 0x14;
+const uint8_t ADDR_CURSOR_ATTR = 0x15; // attribute for the ADDR_CHAR_STREAM writes
+
+// 0x40...0x5F: write a char with the cursor attribute at the current position
+// and advance x, the range lets one incrementing burst carry a whole row
+const uint8_t ADDR_CHAR_STREAM = 0x40;
 
 const uint8_t ADDR_FONT_RST = 0x20;
 const uint8_t ADDR_FONT_DATA = 0x21;
@@ -40,13 +45,21 @@ const uint8_t ADDR_FONT_DATA_WR = 0x22;
 
 OSD::OSD(void)
 {
+  invalidate();
 }
 
 /****************************************************************************/
 
-void OSD::begin(m_cb act)
+void OSD::begin(m_cb act, m_burst_cb bst)
 {
   action = act;
+  burst = bst;
+}
+
+void OSD::setStream(bool enable)
+{
+  stream = enable;
+  cursor_attr = -1;
 }
 
 /****************************************************************************/
@@ -171,31 +184,118 @@ void OSD::scrollbar(uint8_t x, uint8_t y, uint8_t height, uint32_t val, uint32_t
 
 size_t OSD::write(uint8_t chr)
 {
-  uint8_t prev_attr = attr[current_y][current_x];
-  uint8_t prev_data = data[current_y][current_x];
-  uint8_t color = fg_color << 4;
-  data[current_y][current_x] = chr;
-  attr[current_y][current_x] = bg_color + color;
-  if (prev_attr != bg_color+color || prev_data != chr) {
-    changed[current_y][current_x] = true;
+  uint8_t y = current_y;
+  uint8_t x = current_x;
+  uint8_t a = bg_color + (fg_color << 4);
+  data[y][x] = chr;
+  attr[y][x] = a;
+  // compare with what was transmitted, so redrawing the same content
+  // after a clear() costs nothing
+  if (!sent_valid || sent_data[y][x] != chr || sent_attr[y][x] != a) {
+    dirty[y] |= 1UL << x;
+    dirty_rows |= 1UL << y;
+  } else if (dirty[y]) {
+    dirty[y] &= ~(1UL << x);
+    if (!dirty[y]) dirty_rows &= ~(1UL << y);
   }
   setPos(current_x+1, current_y);
   return 1;
 }
 
-void OSD::update()
+void OSD::printn(const char* str, uint8_t len, bool pad)
+{
+  uint8_t i = 0;
+  for (; i < len && str[i]; i++) {
+    write(str[i]);
+  }
+  if (pad) {
+    for (; i < len; i++) {
+      write(' ');
+    }
+  }
+}
+
+void OSD::invalidate()
+{
+  sent_valid = false;
+  cursor_attr = -1;
+  for (uint8_t y=0; y<SIZE_Y; y++) {
+    dirty[y] = 0xFFFFFFFFUL >> (32 - SIZE_X);
+  }
+  dirty_rows = (1UL << SIZE_Y) - 1;
+}
+
+// send cells x1..x2 of a row: position once, then runs of chars
+// sharing the same attribute
+void OSD::sendSpan(uint8_t y, uint8_t x1, uint8_t x2)
 {
-  for (uint8_t y=0; y<OSD::SIZE_Y; y++) {
-    for (uint8_t x=0; x<OSD::SIZE_X; x++) {
-      if (changed[y][x]) {
-        action(CMD_OSD, ADDR_SET_POS_X, x);
-        action(CMD_OSD, ADDR_SET_POS_Y, y);
-        action(CMD_OSD, ADDR_CHAR, data[y][x]);
-        action(CMD_OSD, ADDR_ATTR, attr[y][x]);
-        changed[y][x] = false;
+  uint8_t pos[2] = {x1, y};
+  burst(CMD_OSD, ADDR_SET_POS_X, pos, sizeof(pos));
+  uint8_t x = x1;
+  while (x <= x2) {
+    uint8_t a = attr[y][x];
+    uint8_t n = 1;
+    while (x + n <= x2 && attr[y][x + n] == a) n++;
+    if (a != cursor_attr) {
+      action(CMD_OSD, ADDR_CURSOR_ATTR, a);
+      cursor_attr = a;
+    }
+    burst(CMD_OSD, ADDR_CHAR_STREAM, &data[y][x], n);
+    x += n;
+  }
+  memcpy(&sent_data[y][x1], &data[y][x1], x2 - x1 + 1);
+  memcpy(&sent_attr[y][x1], &attr[y][x1], x2 - x1 + 1);
+}
+
+void OSD::sendCell(uint8_t y, uint8_t x)
+{
+  if (burst) {
+    // SET_POS_X, SET_POS_Y, CHAR, ATTR registers are consecutive
+    uint8_t cell[4] = {x, y, data[y][x], attr[y][x]};
+    burst(CMD_OSD, ADDR_SET_POS_X, cell, sizeof(cell));
+  } else {
+    action(CMD_OSD, ADDR_SET_POS_X, x);
+    action(CMD_OSD, ADDR_SET_POS_Y, y);
+    action(CMD_OSD, ADDR_CHAR, data[y][x]);
+    action(CMD_OSD, ADDR_ATTR, attr[y][x]);
+  }
+  sent_data[y][x] = data[y][x];
+  sent_attr[y][x] = attr[y][x];
+}
+
+void OSD::update(bool now)
+{
+  pending = true;
+  if (now) flush();
+}
+
+void OSD::flush()
+{
+  if (!pending) return;
+  pending = false;
+  // walk the dirty bits only, the cost follows the size of the change
+  while (dirty_rows) {
+    uint8_t y = __builtin_ctz(dirty_rows);
+    uint32_t m = dirty[y];
+    while (m) {
+      uint8_t x1 = __builtin_ctz(m);
+      m &= m - 1;
+      if (!(stream && burst)) {
+        sendCell(y, x1);
+        continue;
+      }
+      // a few unchanged cells are cheaper to resend than a new position
+      uint8_t x2 = x1;
+      while (m && __builtin_ctz(m) - x2 <= 4) {
+        x2 = __builtin_ctz(m);
+        m &= m - 1;
       }
+      sendSpan(y, x1, x2);
     }
+    dirty[y] = 0;
+    dirty_rows &= ~(1UL << y);
   }
+  sent_valid = true;
 }
 
 /****************************************************************************/
@@ -209,6 +309,7 @@ void OSD::setColor(uint8_t color, uint8_t bgcolor)
 /****************************************************************************/
 
 void OSD::showMenu() {
+  flush(); // show the up to date contents
   action(CMD_OSD, ADDR_SHOW, 1);
 }
 
@@ -217,6 +318,7 @@ void OSD::hideMenu() {
 }
 
 void OSD::showPopup(uint8_t i) {
+  flush();
   action(CMD_OSD, ADDR_POPUP, (i << 4) + 1);
 }
 
@@ -230,8 +332,14 @@ void OSD::fontReset() {
 }
 
 void OSD::fontSend(uint8_t data) {
-  action (CMD_OSD, ADDR_FONT_DATA, data);
-  action (CMD_OSD, ADDR_FONT_DATA_WR, 1);
+  if (burst) {
+    // FONT_DATA, FONT_DATA_WR
+    uint8_t buf[2] = {data, 1};
+    burst(CMD_OSD, ADDR_FONT_DATA, buf, sizeof(buf));
+  } else {
+    action (CMD_OSD, ADDR_FONT_DATA, data);
+    action (CMD_OSD, ADDR_FONT_DATA_WR, 1);
+  }
 }
 
 void OSD::line(uint8_t y) {
@@ -25,6 +25,7 @@ class OSD : public Print
 {
 
   using m_cb = void (*)(uint8_t cmd, uint8_t addr, uint8_t data); // alias function pointer
+  using m_burst_cb = void (*)(uint8_t cmd, uint8_t addr, const uint8_t *buf, uint16_t len); // burst write, addr auto-increments
 
 private:
   static const uint8_t SIZE_X = 32;
@@ -35,8 +36,19 @@ private:
   uint8_t current_y=0;
   uint8_t data[SIZE_Y][SIZE_X] = {0};
   uint8_t attr[SIZE_Y][SIZE_X] = {0};
-  bool changed[SIZE_Y][SIZE_X] = {false};
+  uint8_t sent_data[SIZE_Y][SIZE_X] = {0}; // last transmitted framebuffer
+  uint8_t sent_attr[SIZE_Y][SIZE_X] = {0};
+  bool sent_valid = false; // sent_* match the fpga side
+  uint32_t dirty[SIZE_Y]; // per row, bit x = cell differs from sent_*
+  uint32_t dirty_rows; // bit y = dirty[y] != 0
+  bool pending = false; // update() requested, not flushed yet
   m_cb action;
+  m_burst_cb burst = nullptr;
+  bool stream = false; // fpga side has the auto-increment cursor registers
+  int16_t cursor_attr = -1; // last ADDR_CURSOR_ATTR sent, -1 = unknown
+
+  void sendSpan(uint8_t y, uint8_t x1, uint8_t x2);
+  void sendCell(uint8_t y, uint8_t x);
 
 protected:
 
@@ -87,9 +99,20 @@ public:
   /**
    * Begin operation
    *
-   * Sets pins correctly, and prepares SPI bus.
+   * @param act single command callback
+   * @param bst optional burst callback, used to send several registers at once
    */
-  void begin(m_cb act);
+  void begin(m_cb act, m_burst_cb bst = nullptr);
+
+  /**
+   * Enable row streaming updates
+   *
+   * The fpga side must implement ADDR_CURSOR_ATTR and the ADDR_CHAR_STREAM
+   * range, otherwise every cell is sent with its own position
+   *
+   * @param enable
+   */
+  void setStream(bool enable);
 
   /**
    * Set character position
@@ -121,9 +144,35 @@ public:
   virtual size_t write(uint8_t chr);
 
   /**
-   * Send the changed data of the internal framebuffer to the FPGA side
+   * Print at most len characters, without a temporary copy
+   *
+   * @param str string
+   * @param len max characters
+   * @param pad fill up to len with spaces
+   */
+  void printn(const char* str, uint8_t len, bool pad = false);
+
+  /**
+   * Mark the framebuffer ready to be shown
+   *
+   * The changes are sent by the next flush(), once per main loop pass,
+   * so several updates of the same screen cost a single transfer
+   *
+   * @param now flush right away (progress in blocking loops)
+   */
+  void update(bool now = false);
+
+  /**
+   * Send the changed data of the internal framebuffer to the FPGA side,
+   * if an update was requested
+   */
+  void flush(void);
+
+  /**
+   * Forget what the FPGA side shows, the next update() sends everything
+   * (e.g. after a new bitstream is loaded)
    */
-  void update(void);
+  void invalidate(void);
 
   void fill(uint8_t chr);
   void fill(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t chr);
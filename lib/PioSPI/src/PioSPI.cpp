@@ -52,6 +52,8 @@ _cpha1Pgm(&spi_cpha1_program) {
     _initted = false ;
     _running = false ;
     _beginned = false ;
+    _spi.tx_dma = -1 ;
+    _spi.rx_dma = -1 ;
 }
 
 inline bool PioSPI::cpol() {
@@ -120,6 +122,12 @@ uint16_t PioSPI::transfer16(uint16_t data) {
 void PioSPI::transfer(void *buf, size_t count) {
     DEBUGPIOSPI("SPI::transfer(%p, %d)\n", buf, count);
     uint8_t *buff = reinterpret_cast<uint8_t *>(buf);
+    // SdFat sector reads/writes land here, move them by DMA in place
+    if (_initted && _BITORDER == MSBFIRST && count >= PIOSPI_DMA_MIN_LEN) {
+        pio_spi_write8_read8_dma(&_spi, buff, buff, count);
+        DEBUGPIOSPI("SPI::transfer completed\n");
+        return;
+    }
     for (size_t i = 0; i < count; i++) {
         *buff = transfer(*buff);
         *buff = (_BITORDER == MSBFIRST) ? *buff : reverseByte(*buff);
@@ -138,6 +146,10 @@ void PioSPI::transfer(const void *txbuf, void *rxbuf, size_t count) {
     uint8_t *rxbuff = (uint8_t*)(rxbuf);
 
     if (_BITORDER == MSBFIRST) {
+        if (txbuf != NULL && rxbuf != NULL && count >= PIOSPI_DMA_MIN_LEN) {
+            pio_spi_write8_read8_dma(&_spi, txbuff, rxbuff, count);
+            return;
+        }
         if (rxbuf == NULL) { 
             pio_spi_write8_blocking(&_spi,  (uint8_t *) txbuff, count);
             return;
@@ -251,6 +263,7 @@ bool PioSPI::setTX(pin_size_t pin) {
 }
 
 void PioSPI::begin() {
+    pio_spi_dma_init(&_spi);
     gpio_init(_cs);
     gpio_set_dir(_cs, GPIO_OUT);
     gpio_put(_cs, 1);
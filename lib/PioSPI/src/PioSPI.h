@@ -28,6 +28,9 @@ extern "C" {
 #include "pio_spi.h"
 }
 
+// block transfers of this size and up go through DMA
+#define PIOSPI_DMA_MIN_LEN 16
+
 class PioSPI : public arduino::HardwareSPI {
 public:
     PioSPI(pin_size_t tx, pin_size_t rx, pin_size_t sck, pin_size_t cs ,uint8_t data_mode, uint32_t frequency);
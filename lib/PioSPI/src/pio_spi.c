@@ -5,6 +5,7 @@
  */
 
 #include "pio_spi.h"
+#include "hardware/dma.h"
 
 // Just 8 bit functions provided here. The PIO program supports any frame size
 // 1...32, but the software to do the necessary FIFO shuffling is left as an
@@ -66,3 +67,33 @@ void __time_critical_func(pio_spi_write8_read8_blocking)(const pio_spi_inst_t *s
     }
 }
 
+
+// DMA variant for block transfers: one channel feeds the TX FIFO, another one
+// drains the RX FIFO. src == dst is allowed, RX always lags behind TX.
+// Channels are claimed once and reconfigured per call, since the SM may change
+// between transactions.
+
+void pio_spi_dma_init(pio_spi_inst_t *spi) {
+    if (spi->tx_dma < 0) spi->tx_dma = dma_claim_unused_channel(true);
+    if (spi->rx_dma < 0) spi->rx_dma = dma_claim_unused_channel(true);
+}
+
+void __time_critical_func(pio_spi_write8_read8_dma)(const pio_spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    dma_channel_config c = dma_channel_get_default_config(spi->tx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(spi->pio, spi->sm, true));
+    // 8 bit writes are byte-replicated, same as in the blocking version
+    dma_channel_configure(spi->tx_dma, &c, (io_rw_8 *) &spi->pio->txf[spi->sm], src, len, false);
+
+    c = dma_channel_get_default_config(spi->rx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(spi->pio, spi->sm, false));
+    dma_channel_configure(spi->rx_dma, &c, dst, (io_rw_8 *) &spi->pio->rxf[spi->sm], len, false);
+
+    dma_start_channel_mask((1u << spi->tx_dma) | (1u << spi->rx_dma));
+    dma_channel_wait_for_finish_blocking(spi->rx_dma);
+}
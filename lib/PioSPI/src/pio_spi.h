@@ -13,6 +13,8 @@ typedef struct pio_spi_inst {
     PIO pio;
     uint sm;
     uint cs_pin;
+    int tx_dma;
+    int rx_dma;
 } pio_spi_inst_t;
 
 void pio_spi_write8_blocking(const pio_spi_inst_t *spi, const uint8_t *src, size_t len);
@@ -21,4 +23,8 @@ void pio_spi_read8_blocking(const pio_spi_inst_t *spi, uint8_t *dst, size_t len)
 
 void pio_spi_write8_read8_blocking(const pio_spi_inst_t *spi, uint8_t *src, uint8_t *dst, size_t len);
 
+void pio_spi_dma_init(pio_spi_inst_t *spi);
+
+void pio_spi_write8_read8_dma(const pio_spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+
 #endif
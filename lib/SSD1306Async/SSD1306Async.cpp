@@ -0,0 +1,115 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#include "SSD1306Async.h"
+
+/****************************************************************************/
+
+SSD1306Async::SSD1306Async(uint8_t w, uint8_t h, TwoWire *twi, uint32_t clk) :
+  Adafruit_SSD1306(w, h, twi, -1, clk, clk),
+  shadow(NULL), pages((h + 7) / 8), force(0), scan_page(0), cur_page(-1), cur_col(0), end_col(0)
+{
+}
+
+/****************************************************************************/
+
+SSD1306Async::~SSD1306Async()
+{
+  if (shadow) free(shadow);
+}
+
+/****************************************************************************/
+
+bool SSD1306Async::begin(uint8_t vcs, uint8_t addr)
+{
+  if (!Adafruit_SSD1306::begin(vcs, addr)) return false;
+  if (!shadow && !(shadow = (uint8_t *) malloc(WIDTH * pages))) return false;
+  invalidate();
+  return true;
+}
+
+/****************************************************************************/
+
+void SSD1306Async::display()
+{
+  Adafruit_SSD1306::display();
+  memcpy(shadow, buffer, WIDTH * pages);
+  force = 0;
+  cur_page = -1;
+}
+
+/****************************************************************************/
+
+void SSD1306Async::invalidate()
+{
+  force = (1 << pages) - 1;
+  cur_page = -1;
+}
+
+/****************************************************************************/
+
+bool SSD1306Async::find_dirty()
+{
+  for (uint8_t i = 0; i < pages; i++) {
+    uint8_t page = (scan_page + i) % pages;
+    const uint8_t *buf = &buffer[page * WIDTH];
+    const uint8_t *shd = &shadow[page * WIDTH];
+    int16_t first = 0;
+    int16_t last = WIDTH - 1;
+    if (!bitRead(force, page)) {
+      while (first < WIDTH && buf[first] == shd[first]) first++;
+      if (first == WIDTH) continue;
+      while (buf[last] == shd[last]) last--;
+    }
+    bitClear(force, page);
+    cur_page = page;
+    cur_col = first;
+    end_col = last;
+    // continue with the next page next time, so a page that keeps
+    // changing does not starve the others
+    scan_page = (page + 1) % pages;
+    // the panel auto-increments within this window
+    uint8_t cmd[] = {SSD1306_COLUMNADDR, cur_col, end_col, SSD1306_PAGEADDR, (uint8_t) page, (uint8_t) page};
+    ssd1306_commandList(cmd, sizeof(cmd));
+    return true;
+  }
+  return false;
+}
+
+/****************************************************************************/
+
+bool SSD1306Async::tick(uint8_t max_bytes)
+{
+  if (!shadow) return false;
+  if (cur_page < 0 && !find_dirty()) return false;
+
+  uint16_t pos = cur_page * WIDTH + cur_col;
+  uint8_t n = min((int) max_bytes, end_col - cur_col + 1);
+  wire->beginTransmission(i2caddr);
+  wire->write((uint8_t) 0x40);
+  wire->write(&buffer[pos], n);
+  wire->endTransmission();
+  memcpy(&shadow[pos], &buffer[pos], n);
+
+  if (cur_col + n > end_col) {
+    cur_page = -1;
+  } else {
+    cur_col += n;
+  }
+  return true;
+}
+
+/****************************************************************************/
+
+bool SSD1306Async::busy()
+{
+  if (!shadow) return false;
+  return cur_page >= 0 || force || memcmp(shadow, buffer, WIDTH * pages) != 0;
+}
+
+// vim:cin:ai:sts=2 sw=2 ft=cpp
@@ -0,0 +1,77 @@
+/*
+ Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef __SSD1306_ASYNC_H__
+#define __SSD1306_ASYNC_H__
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+#define SSD1306_ASYNC_CHUNK 32 // data bytes per i2c transaction
+
+/****************************************************************************/
+
+/**
+ * SSD1306 with incremental refresh.
+ * Drawing goes to the Adafruit framebuffer as usual, tick() then sends
+ * the columns that differ from the panel contents, one short i2c
+ * transaction per call, so the refresh can be spread over the main loop
+ * passes instead of blocking for a whole frame.
+ */
+
+class SSD1306Async : public Adafruit_SSD1306
+{
+
+private:
+  uint8_t *shadow; // what the panel shows
+  uint8_t pages;
+  uint8_t force; // pages to resend regardless of the shadow
+  uint8_t scan_page;
+  int16_t cur_page;
+  uint8_t cur_col;
+  uint8_t end_col;
+
+  bool find_dirty();
+
+public:
+
+  /**
+   * @param clk i2c clock, kept for the whole session (the other
+   * devices on the bus have to support it too)
+   */
+  SSD1306Async(uint8_t w, uint8_t h, TwoWire *twi, uint32_t clk = 400000UL);
+  ~SSD1306Async();
+
+  bool begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t addr = 0x3C);
+
+  /**
+   * Blocking full refresh, keeps the shadow in sync
+   */
+  void display();
+
+  /**
+   * Send the next chunk of changed data, if any
+   * @param max_bytes data bytes to send at most
+   * @return true if something was sent
+   */
+  bool tick(uint8_t max_bytes = SSD1306_ASYNC_CHUNK);
+
+  /**
+   * @return true while the panel differs from the framebuffer
+   */
+  bool busy();
+
+  /**
+   * Resend everything on the next ticks (e.g. after a panel reset)
+   */
+  void invalidate();
+};
+
+#endif // __SSD1306_ASYNC_H__
+// vim:cin:ai:sts=2 sw=2 ft=cpp
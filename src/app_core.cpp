@@ -10,6 +10,10 @@
 #include <algorithm>
 #include <tuple>
 #include "sorts.h"
+#include "spi_stream.h"
+#include "strutil.h"
+#include "collate.h"
+#include "file_index.h"
 
 uint8_t curr_osd_item;
 bool is_filebrowser = false;
@@ -117,30 +121,30 @@ void app_core_overlay(bool force)
 
 void app_core_menu(uint8_t vpos) {
   for (uint8_t i=0; i<core.osd_len; i++) {
-    String name = String(core.osd[i].name);
-    String hotkey = String(core.osd[i].hotkey);
+    const char* name = core.osd[i].name;
+    const char* hotkey = core.osd[i].hotkey;
     zxosd.setPos(0, i+vpos);
     zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
     // text line (32 chars)
     if (core.osd[i].type == CORE_OSD_TYPE_TEXT) {
-      name = name + hotkey;
-      zxosd.print(name.substring(0,32));
+      uint8_t l = strnlen(name, 32);
+      zxosd.printn(name, l);
+      zxosd.printn(hotkey, 32 - l);
     // normal osd line (name, option, hotkey)
     } else {
-      zxosd.print(name.substring(0,10));
+      zxosd.printn(name, 10);
 
-      String option;
+      const char* option;
+      bool pad = false;
       if (core.osd[i].type == CORE_OSD_TYPE_FILEMOUNTER || core.osd[i].type == CORE_OSD_TYPE_FILELOADER) {
         if (file_slots[core.osd[i].slot_id].is_mounted) {
-          option = String(file_slots[core.osd[i].slot_id].filename);
+          option = file_slots[core.osd[i].slot_id].filename;
         } else {
-          option = String("-NO IMAGE-");
+          option = "-NO IMAGE-";
         }
       } else {
-        option = String(core.osd[i].options[core.osd[i].val].name);
-        while (option.length() < 10) {
-          option = option + " ";
-        }
+        option = core.osd[i].options[core.osd[i].val].name;
+        pad = true;
       }
       zxosd.setPos(11, i+vpos);
       if (curr_osd_item == i) {
@@ -148,13 +152,12 @@ void app_core_menu(uint8_t vpos) {
       } else {
         zxosd.setColor(OSD::COLOR_YELLOW_I, OSD::COLOR_BLACK);
       }
-      zxosd.print(option.substring(0, 10));
+      zxosd.printn(option, 10, pad);
 
-      String hotkey = String(core.osd[i].hotkey);
       zxosd.setColor(OSD::COLOR_CYAN_I, OSD::COLOR_BLACK);
       if (core.osd[i].options_len > 0 || core.osd[i].type == CORE_OSD_TYPE_FILEMOUNTER || core.osd[i].type == CORE_OSD_TYPE_FILELOADER) {
         zxosd.setPos(22, i+vpos);
-        zxosd.print(hotkey.substring(0,10));
+        zxosd.printn(hotkey, 10);
       } else {
         zxosd.setPos(11, i+vpos);
         zxosd.print(hotkey);
@@ -252,14 +255,11 @@ void app_core_on_keyboard() {
         if (file1.isOpen()) {
           file1.close();
         }
-        String hash = String(files[file_sel].hash);
-        hash.trim();
+        core_file_slot_t *slot = &file_slots[core.osd[curr_osd_item].slot_id];
         // goto root (.)
-        if (files[file_sel].file_id == 0 && hash == ".") {
-          String dir = "/";
-          String f = "";
-          dir.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].dir, sizeof(file_slots[core.osd[curr_osd_item].slot_id].dir));
-          f.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].filename, sizeof(file_slots[core.osd[curr_osd_item].slot_id].filename));
+        if (files[file_sel].file_id == 0 && memcmp(files[file_sel].key, ".", 2) == 0) {
+          strcpy(slot->dir, "/");
+          slot->filename[0] = '\0';
           // re-read files from root
           file_sel = 0;
           cached_file_from = 0;
@@ -270,14 +270,10 @@ void app_core_on_keyboard() {
           return;
         }
         // goto parent (..)
-        else if (files[file_sel].file_id == 0 && hash == "..") {
-          String dir = String(file_slots[core.osd[curr_osd_item].slot_id].dir);
-          String f = "";
-          f.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].filename, sizeof(file_slots[core.osd[curr_osd_item].slot_id].filename));
-          dir = dir.substring(0, dir.lastIndexOf("/"));
-          dir.replace("//", "/");
-          d_print("Enter directory "); d_print(dir); d_println();
-          dir.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].dir, sizeof(file_slots[core.osd[curr_osd_item].slot_id].dir));
+        else if (files[file_sel].file_id == 0 && memcmp(files[file_sel].key, "..", 3) == 0) {
+          slot->filename[0] = '\0';
+          path_parent(slot->dir);
+          d_print("Enter directory "); d_print(slot->dir); d_println();
           // re-read files from parent dir
           file_sel = 0;
           cached_file_from = 0;
@@ -293,11 +289,10 @@ void app_core_on_keyboard() {
           if (file1.isDir()) {
             char dirname[255];
             file1.getName(dirname, sizeof(dirname));
-            String dir = String(file_slots[core.osd[curr_osd_item].slot_id].dir) + "/" + String(dirname);
-            dir.replace("//", "/");
-            String f = "";
-            dir.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].dir, sizeof(file_slots[core.osd[curr_osd_item].slot_id].dir));
-            f.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].filename, sizeof(file_slots[core.osd[curr_osd_item].slot_id].filename));
+            char dir[sizeof(slot->dir)];
+            path_join(dir, sizeof(dir), slot->dir, dirname);
+            strcpy(slot->dir, dir);
+            slot->filename[0] = '\0';
             file_sel = 0;
             cached_file_from = 0;
             cached_file_to = 0;
@@ -314,12 +309,7 @@ void app_core_on_keyboard() {
             file1.getSFN(filename, sizeof(filename));
             d_printf("Filename %s", filename);
             // check file ext match
-            String exts = String(file_slots[core.osd[curr_osd_item].slot_id].ext);
-            exts.toLowerCase(); exts.trim();
-            char e[33];
-            exts.toCharArray(e, 32);
-            uint8_t len = strlen(filename);
-            if (exts.length() == 0 || exts.indexOf(strlwr(filename + (len - 4))) != -1) {
+            if (path_ext_match(slot->ext, filename)) {
               strcpy(file_slots[core.osd[curr_osd_item].slot_id].filename, filename);
               file_slots[core.osd[curr_osd_item].slot_id].is_mounted = true;
               app_core_on_select_file();
@@ -439,12 +429,10 @@ int app_core_init_filebrowser() {
   if (!has_sd) return -1;
 
   // working dir
-  String dir = String(file_slots[core.osd[curr_osd_item].slot_id].dir);
-  if (dir == "") { dir = "/"; }
-  if (dir.charAt(0) != '/') { dir = '/' + dir; }
-  dir.toCharArray(file_slots[core.osd[curr_osd_item].slot_id].dir, sizeof(file_slots[core.osd[curr_osd_item].slot_id].dir));
-  String sfilename = String( file_slots[core.osd[curr_osd_item].slot_id].filename);
-  String sfullname = dir + "/" + sfilename;
+  core_file_slot_t *slot = &file_slots[core.osd[curr_osd_item].slot_id];
+  char dir[sizeof(slot->dir)];
+  path_dir(dir, sizeof(dir), slot->dir);
+  strcpy(slot->dir, dir);
   sd1.chdir(dir);
 
   if (root1.isOpen()) {
@@ -468,13 +456,13 @@ int app_core_init_filebrowser() {
 
   // add root entry
   files[files_len].file_id = 0;
-  String s = String("."); s.toCharArray(files[files_len].hash, sizeof(files[files_len].hash));
+  collate_key(files[files_len].key, SORT_KEY_LEN, ".");
   files_len++;
 
   // add parent dir entry
-  if (dir.length() > 1) {
+  if (strlen(dir) > 1) {
     files[files_len].file_id = 0;
-    String s = String(".."); s.toCharArray(files[files_len].hash, sizeof(files[files_len].hash));
+    collate_key(files[files_len].key, SORT_KEY_LEN, "..");
     files_len++;
   }
 
@@ -483,13 +471,10 @@ int app_core_init_filebrowser() {
     char filename[14]; file1.getSFN(filename, sizeof(filename));
     uint8_t len = strlen(filename);  
     if (files_len < SORT_FILES_MAX) {
-      memcpy(files[files_len].hash, filename, SORT_HASH_LEN);
+      char name[255]; file1.getName(name, sizeof(name));
+      collate_key(files[files_len].key, SORT_KEY_LEN, name);
       files[files_len].file_id = file1.dirIndex();
-      String core_f = String(file_slots[core.osd[curr_osd_item].slot_id].filename);
-      String f = String(filename);
-      core_f.toLowerCase();
-      f.toLowerCase();
-      if (core_f.length() > 0 && core_f.indexOf(f) == 0) {
+      if (slot->filename[0] != '\0' && strncasecmp(slot->filename, filename, len) == 0) {
         presel_id = files[files_len].file_id;
       }
       files_len++;
@@ -500,6 +485,7 @@ int app_core_init_filebrowser() {
   d_print("Files count "); d_print(files_len); d_println();
 
   std::sort(files, files + files_len);
+  file_index_sort_ties(&root1, files, files_len, files + files_len, (SORT_FILES_MAX - files_len) * sizeof(files[0]));
 
   // preselect file in browser after sorting
   for (uint16_t i=0; i<files_len; i++) {
@@ -525,7 +511,7 @@ void app_core_filebrowser(uint8_t vpos) {
     root1.close();
   }
 
-  String dir = String(file_slots[core.osd[curr_osd_item].slot_id].dir);
+  const char* dir = file_slots[core.osd[curr_osd_item].slot_id].dir;
   root1 = sd1.open(dir);
 
   if (files_len > 0) {
@@ -542,18 +528,17 @@ void app_core_filebrowser(uint8_t vpos) {
       if (cached_file_from == file_from && cached_file_to == file_to) {
         memcpy(name, cached_names[j].name, sizeof(name));
       } else {
-        String h = String(files[i].hash);
-        if (files[i].file_id == 0 && (h == "." || h == "..")) {
-          h.toCharArray(name, sizeof(name));
-          h.toCharArray(cached_names[j].name, sizeof(cached_names[j].name));
+        if (files[i].file_id == 0 && files[i].key[0] == '.') {
+          // . or ..
+          memcpy(name, files[i].key, SORT_KEY_LEN); name[SORT_KEY_LEN] = '\0';
+          str_copy(cached_names[j].name, sizeof(cached_names[j].name), name);
         }
         else if (file1.open(&root1, files[i].file_id)) {
           char filename[255];
           file1.getName(filename, sizeof(filename));
-          String f(filename);
-          f.trim();
-          f.toCharArray(name, sizeof(name));
-          f.toCharArray(cached_names[j].name, sizeof(cached_names[j].name));
+          str_trim(filename);
+          str_copy(name, sizeof(name), filename);
+          str_copy(cached_names[j].name, sizeof(cached_names[j].name), filename);
           file1.close();
         }
       }
@@ -585,8 +570,7 @@ void app_core_filebrowser(uint8_t vpos) {
   zxosd.line(21);
   zxosd.fill(0, vpos + file_page_size + 1, 31, vpos + file_page_size + 1, ' ');
   zxosd.setPos(8, vpos + file_page_size + 1); 
-  dir = dir.substring(0, 20);
-  zxosd.print("Dir "); zxosd.print(dir);
+  zxosd.print("Dir "); zxosd.printn(dir, 20);
   // display pager
   zxosd.setPos(0, vpos + file_page_size + 2); zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
   zxosd.print("        ");
@@ -602,7 +586,7 @@ void app_core_on_select_file() {
   if (core.osd[curr_osd_item].type == CORE_OSD_TYPE_FILELOADER) {
 
     zxosd.loadingPopup();
-    zxosd.update();
+    zxosd.update(true);
 
     // send ioctl slot id, file data for file loader type
     spi_send(CMD_IOCTL_STATE, 0, 1); // start
@@ -610,39 +594,44 @@ void app_core_on_select_file() {
 
     uint64_t fsize = 0;
     spi_send64(CMD_IOCTL_SIZE, fsize);
-    String fname = String(file_slots[core.osd[curr_osd_item].slot_id].dir) + "/" + String(file_slots[core.osd[curr_osd_item].slot_id].filename);
+    static char fname[512];
+    path_join(fname, sizeof(fname), file_slots[core.osd[curr_osd_item].slot_id].dir, file_slots[core.osd[curr_osd_item].slot_id].filename);
     File32 file = sd1.open(fname);
     fsize = file.size();
     spi_send64(CMD_IOCTL_SIZE, fsize);
 
-    String ext = fname.substring(fname.lastIndexOf('.')+1);
-    for(uint8_t i = 0; i<ext.length(); i++) {
-      spi_send(CMD_IOCTL_EXT, i, ext.charAt(i));
+    const char* ext = path_ext(fname);
+    for(uint8_t i = 0; ext[i]; i++) {
+      spi_send(CMD_IOCTL_EXT, i, ext[i]);
     }
 
-    for(uint64_t i = 0; i < fsize; i++) {
+    uint8_t *buf;
+    uint64_t i = 0;
+    int c;
+    // ioctl bank every 256 bytes, then lower 256 bytes
+    spi_stream_begin(CMD_IOCTL_BANK, CMD_IOCTL_DATA, 0);
+    while (i < fsize && (c = file.read(buf = spi_stream_acquire(), SPI_STREAM_BUF_SIZE)) > 0) {
       if (i % 8192 == 0) {
         zxosd.loadingPopup(i, fsize);
-        zxosd.update();
-      }
-      if (i % 256 == 0) {
-        spi_send24(CMD_IOCTL_BANK, i >> 8);
+        zxosd.update(true);
       }
-      uint8_t data = file.read();
-      spi_send(CMD_IOCTL_DATA, (uint8_t)((i & 0x00000000000000FF)), data);
+      spi_stream_commit(buf, c);
+      i += c;
     }
+    spi_stream_end();
     file.close();
     spi_send(CMD_IOCTL_STATE, 0, 0); // finish
 
     zxosd.loadingPopup(fsize, fsize);
-    zxosd.update();
+    zxosd.update(true);
 
   } else if (core.osd[curr_osd_item].type == CORE_OSD_TYPE_FILEMOUNTER) {
     // send img slot id, size for file mounter type
     spi_send(CMD_IMG_SLOT, 0, core.osd[curr_osd_item].slot_id);
     uint64_t fsize = 0;
     spi_send64(CMD_IMG_SIZE, fsize);
-    String fname = String(file_slots[core.osd[curr_osd_item].slot_id].dir) + "/" + String(file_slots[core.osd[curr_osd_item].slot_id].filename);
+    static char fname[512];
+    path_join(fname, sizeof(fname), file_slots[core.osd[curr_osd_item].slot_id].dir, file_slots[core.osd[curr_osd_item].slot_id].filename);
     File32 file = sd1.open(fname);
     fsize = file.size();
     spi_send64(CMD_IMG_SIZE, fsize);
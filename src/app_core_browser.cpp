@@ -4,6 +4,7 @@
 #include "main.h"
 #include "FT812.h"
 #include "bitmaps.h"
+#include "bitmaps_z.h"
 #include "OSD.h"
 #include "SdFat.h"
 #include "SegaController.h"
@@ -13,6 +14,11 @@
 #include "app_core_browser.h"
 #include "app_setup.h"
 #include "sorts.h"
+#include "profiler.h"
+#include "spi_events.h"
+#include "scheduler.h"
+#include "strutil.h"
+#include "typeahead.h"
 #include <cstdio>
 #include <iostream>
 using namespace std;
@@ -20,6 +26,7 @@ using namespace std;
 core_list_item_t cores[MAX_CORES];
 uint8_t cores_len = 0;
 uint8_t core_sel = 0;
+static typeahead_t core_search;
 const uint8_t core_page_size = MAX_CORES_PER_PAGE;
 const uint8_t ft_core_page_size = MAX_CORES_PER_PAGE/2;
 uint8_t core_pages = 1;
@@ -29,6 +36,42 @@ ElapsedTimer autoload_timer;
 bool autoload_enabled;
 uint32_t autoload_countdown;
 
+// FT812 GRAM resource ids, bump FT_ASSETS_VERSION when bitmaps.h changes
+enum ft_asset_e {
+  ft_asset_logo = 1,
+  ft_asset_bg,
+  ft_asset_dl,
+  ft_asset_key1, // key sounds follow
+};
+
+// key sounds are stored deflate compressed (tools/ft_assets.py) and inflated by the FT812
+static_assert(KEY1_ZRAW == KEY1_SIZE && KEY2_ZRAW == KEY2_SIZE && KEY3_ZRAW == KEY3_SIZE && KEY4_ZRAW == KEY4_SIZE,
+  "bitmaps_z.h is stale, run tools/ft_assets.py build src/bitmaps.h src/bitmaps_z.h");
+
+typedef struct {
+  const uint8_t *zdata;
+  uint32_t zsize;
+  uint32_t size;
+  uint32_t samplerate;
+  uint32_t duration;
+} ft_key_sound_t;
+
+static const ft_key_sound_t ft_key_sounds[] = {
+  {key1ZData, KEY1_ZSIZE, KEY1_SIZE, KEY1_SAMPLERATE, KEY1_DURATION},
+  {key2ZData, KEY2_ZSIZE, KEY2_SIZE, KEY2_SAMPLERATE, KEY2_DURATION},
+  {key3ZData, KEY3_ZSIZE, KEY3_SIZE, KEY3_SAMPLERATE, KEY3_DURATION},
+  {key4ZData, KEY4_ZSIZE, KEY4_SIZE, KEY4_SAMPLERATE, KEY4_DURATION},
+};
+
+static uint32_t ft_logo_offset = 0;
+static uint32_t ft_bg_offset = 0;
+
+// upload the selected key sound on demand, returns its GRAM offset
+static uint32_t app_core_browser_ft_sound(const ft_key_sound_t *snd) {
+  uint16_t id = ft_asset_key1 + (snd - ft_key_sounds);
+  return ft.gramInflate(id, FT_ASSETS_VERSION, snd->size, snd->zsize, snd->zdata);
+}
+
 void app_core_browser_overlay() {
   zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
   zxosd.clear();
@@ -87,49 +130,38 @@ void app_core_browser_menu(uint8_t vpos) {
 
 void app_core_browser_ft_overlay() {
   ft.setSound(FT81x_SOUND_COWBELL, 60);
-  ft.loadImage(LOGO_OFFSET, LOGO_SIZE, logoData, false); // karabas logo, starts from 0 in GRAM
-  ft.loadImage(BG_OFFSET, BG_SIZE, bgData, false); // karabas bg, starts after logo in GRAM
-  ft.writeGRAM(KEY1_OFFSET, KEY1_SIZE, key1Data); // pcm sound, starts from after logo and bg in GRAM
-  ft.writeGRAM(KEY2_OFFSET, KEY2_SIZE, key2Data); // pcm sound, starts from after logo and bg in GRAM
-  ft.writeGRAM(KEY3_OFFSET, KEY3_SIZE, key3Data); // pcm sound, starts from after logo and bg in GRAM
-  ft.writeGRAM(KEY4_OFFSET, KEY4_SIZE, key4Data); // pcm sound, starts from after logo and bg in GRAM
+  // assets stay resident in GRAM, only missing ones are uploaded
+  ft_logo_offset = ft.gramImage(ft_asset_logo, FT_ASSETS_VERSION, LOGO_BITMAP_SIZE, LOGO_SIZE, logoData); // karabas logo
+  ft_bg_offset = ft.gramImage(ft_asset_bg, FT_ASSETS_VERSION, BG_BITMAP_SIZE, BG_SIZE, bgData); // karabas bg
+  if (hw_setup.ft_sound > 0 && hw_setup.ft_sound <= 4) {
+    app_core_browser_ft_sound(&ft_key_sounds[hw_setup.ft_sound-1]); // pcm sound
+  }
   app_core_browser_ft_menu(0);
 }
 
-void app_core_browser_ft_menu(uint8_t play_sounds) {
-
-  ft.beginDisplayList();
-
+// static part of the ft menu page: background, all buttons of the page in
+// the idle colors, page / copyright texts and bitmaps. It is captured into
+// GRAM once and replayed with CMD_APPEND, only the selected button, the
+// autoload countdown and the clock are drawn per frame.
+static void app_core_browser_ft_static(uint8_t core_from, uint8_t core_to) {
   uint32_t color_black = hw_setup.color_bg;
   uint32_t color_gradient = hw_setup.color_gradient;
   uint32_t color_button = hw_setup.color_button;
-  uint32_t color_button_active = hw_setup.color_active;
   uint32_t color_text = hw_setup.color_text;
-  uint32_t color_text_active = hw_setup.color_text_active;
   uint32_t color_copyright = hw_setup.color_copyright;
 
+  ft.saveContext();
   ft.clear(color_black);
   ft.drawGradient(ft.width()/2, 0, color_gradient, ft.width()/2, ft.height()-ft.height()/4-1, color_black);
 
-  core_pages = ceil((float)cores_len / ft_core_page_size);
-  core_page = ceil((float)(core_sel+1)/ft_core_page_size);
-  uint8_t core_from = (core_page-1)*ft_core_page_size;
-  uint8_t core_to = core_page*ft_core_page_size > cores_len ? cores_len : core_page*ft_core_page_size;
-  uint8_t core_fill = core_page*ft_core_page_size;
   uint8_t pos = 0;
   uint8_t offset = 64 + 16 + 8;
   for(uint8_t i=core_from; i < core_to; i++) {
     char name[18];
-    String n = String(cores[i].name); n.trim(); n.toCharArray(name, 18);
-    const uint32_t colorb = i == core_sel ? color_button_active : color_button;
-    const uint32_t colort = i == core_sel ? color_text_active : color_text;
-    ft.drawButton(ft.width()/4 + 8, offset + pos*40, ft.width()/2-16, 32, 28, colort, colorb, (hw_setup.ft_3d_buttons) ? FT81x_OPT_3D : FT81x_OPT_FLAT , name);
+    str_copy(name, sizeof(name), cores[i].name); str_trim(name);
+    ft.drawButton(ft.width()/4 + 8, offset + pos*40, ft.width()/2-16, 32, 28, color_text, color_button, (hw_setup.ft_3d_buttons) ? FT81x_OPT_3D : FT81x_OPT_FLAT , name);
     if (cores[i].flash) {
-      ft.drawText(ft.width()/4+ft.width()/2-16-24, offset + pos*40 + 16, 28, colort, FT81x_OPT_CENTERY, "F\0");
-    }
-    if (autoload_enabled && i==core_sel) {
-      uint32_t diff = (autoload_timer.elapsed() < autoload_countdown * 1000) ? ceil((autoload_countdown * 1000 - autoload_timer.elapsed())/1000) : 0;
-      ft.drawGauge(ft.width()/4+16+12, offset + pos*40 + 16, 12, colort, colorb, 0, 1, 1, diff, autoload_countdown);
+      ft.drawText(ft.width()/4+ft.width()/2-16-24, offset + pos*40 + 16, 28, color_text, FT81x_OPT_CENTERY, "F\0");
     }
     pos++;
   }
@@ -143,6 +175,102 @@ void app_core_browser_ft_menu(uint8_t play_sounds) {
   sprintf(b, "Page %d of %d\0", core_page, core_pages);
   ft.drawText(ft.width()/2, ft.height()-40, 27, color_copyright, FT81x_OPT_CENTER, b);
 
+  ft.drawBitmap(ft_logo_offset, 8, 8, LOGO_WIDTH, LOGO_HEIGHT, 4, 0);  // logo scaled 4x
+  if (hw_setup.ft_char) {
+    ft.overlayBitmap(ft_bg_offset, ft.width()-BG_WIDTH-8, ft.height()-BG_HEIGHT-8, BG_WIDTH, BG_HEIGHT, 1, 0); // bg image
+  }
+  ft.restoreContext();
+}
+
+// everything the static part depends on, kept for the display list in GRAM and compared as a whole
+typedef struct {
+  uint8_t page;
+  uint8_t pages;
+  uint8_t video_mode;
+  bool buttons_3d;
+  bool character;
+  uint32_t colors[5];
+  uint32_t logo_offset;
+  uint32_t bg_offset;
+  uint8_t count;
+  char names[MAX_CORES_PER_PAGE/2][32+1];
+  bool flash[MAX_CORES_PER_PAGE/2];
+} ft_static_key_t;
+
+static_assert(sizeof(ft_static_key_t::names[0]) == sizeof(core_list_item_t::name), "core name size changed");
+
+static ft_static_key_t ft_static_key;
+
+static void app_core_browser_ft_static_key(ft_static_key_t *k, uint8_t core_from, uint8_t core_to) {
+  memset(k, 0, sizeof(*k)); // padding too, keys are compared with memcmp()
+  k->page = core_page;
+  k->pages = core_pages;
+  k->video_mode = hw_setup.ft_video_mode;
+  k->buttons_3d = hw_setup.ft_3d_buttons;
+  k->character = hw_setup.ft_char;
+  k->colors[0] = hw_setup.color_bg;
+  k->colors[1] = hw_setup.color_gradient;
+  k->colors[2] = hw_setup.color_button;
+  k->colors[3] = hw_setup.color_text;
+  k->colors[4] = hw_setup.color_copyright;
+  k->logo_offset = ft_logo_offset;
+  k->bg_offset = ft_bg_offset;
+  k->count = core_to - core_from;
+  for (uint8_t i = core_from; i < core_to; i++) {
+    memcpy(k->names[i - core_from], cores[i].name, sizeof(k->names[0]));
+    k->flash[i - core_from] = cores[i].flash;
+  }
+}
+
+void app_core_browser_ft_menu(uint8_t play_sounds) {
+
+  uint32_t color_button_active = hw_setup.color_active;
+  uint32_t color_text = hw_setup.color_text;
+  uint32_t color_text_active = hw_setup.color_text_active;
+  uint32_t color_copyright = hw_setup.color_copyright;
+
+  core_pages = ceil((float)cores_len / ft_core_page_size);
+  core_page = ceil((float)(core_sel+1)/ft_core_page_size);
+  uint8_t core_from = (core_page-1)*ft_core_page_size;
+  uint8_t core_to = core_page*ft_core_page_size > cores_len ? cores_len : core_page*ft_core_page_size;
+
+  static uint32_t dl_size = 0;
+  uint32_t dl_offset;
+  ft_static_key_t key;
+  app_core_browser_ft_static_key(&key, core_from, core_to);
+  if (dl_size > 0 && memcmp(&key, &ft_static_key, sizeof(key)) == 0 && ft.gramLookup(ft_asset_dl, FT_ASSETS_VERSION, dl_offset)) {
+    ft.beginDisplayList(dl_offset, dl_size);
+  } else {
+    ft.beginDisplayList();
+    app_core_browser_ft_static(core_from, core_to);
+    dl_offset = ft.gramAlloc(ft_asset_dl, FT_ASSETS_VERSION, FT81x_DL_SIZE);
+    dl_size = ft.captureDisplayList(dl_offset);
+    // after a fifo timeout the copy is left uncommitted and rebuilt next time
+    if (dl_size > 0 && ft.waitForCommandBuffer()) {
+      ft.gramCommit(ft_asset_dl);
+    }
+    ft_static_key = key;
+  }
+
+  // selected button is drawn over its idle copy
+  if (core_sel >= core_from && core_sel < core_to) {
+    uint8_t i = core_sel;
+    uint8_t pos = core_sel - core_from;
+    uint8_t offset = 64 + 16 + 8;
+    char name[18];
+    str_copy(name, sizeof(name), cores[i].name); str_trim(name);
+    ft.drawButton(ft.width()/4 + 8, offset + pos*40, ft.width()/2-16, 32, 28, color_text_active, color_button_active, (hw_setup.ft_3d_buttons) ? FT81x_OPT_3D : FT81x_OPT_FLAT , name);
+    if (cores[i].flash) {
+      ft.drawText(ft.width()/4+ft.width()/2-16-24, offset + pos*40 + 16, 28, color_text_active, FT81x_OPT_CENTERY, "F\0");
+    }
+    if (autoload_enabled) {
+      uint32_t diff = (autoload_timer.elapsed() < autoload_countdown * 1000) ? ceil((autoload_countdown * 1000 - autoload_timer.elapsed())/1000) : 0;
+      ft.drawGauge(ft.width()/4+16+12, offset + pos*40 + 16, 12, color_text_active, color_button_active, 0, 1, 1, diff, autoload_countdown);
+    }
+  }
+
+  char b[40]; 
+
   if (autoload_enabled) {
     uint32_t diff = (autoload_timer.elapsed() < autoload_countdown * 1000) ? ceil((autoload_countdown * 1000 - autoload_timer.elapsed())/1000) : 0;
     sprintf(b, "Autoloading core in %d s\0", diff);
@@ -166,45 +294,10 @@ void app_core_browser_ft_menu(uint8_t play_sounds) {
   if (play_sounds == 1 && hw_setup.ft_click) {
       ft.playSound();
   } else if (play_sounds == 2 && hw_setup.ft_sound > 0) {
-    uint32_t key_size, key_samplerate, key_duration, key_offset;
-    switch (hw_setup.ft_sound) {
-      case 1:
-        key_size = KEY1_SIZE;
-        key_samplerate = KEY1_SAMPLERATE;
-        key_duration = KEY1_DURATION;
-        key_offset = KEY1_OFFSET;
-        break;
-      case 2:
-        key_size = KEY2_SIZE;
-        key_samplerate = KEY2_SAMPLERATE;
-        key_duration = KEY2_DURATION;
-        key_offset = KEY2_OFFSET;
-        break;
-      case 3:
-        key_size = KEY3_SIZE;
-        key_samplerate = KEY3_SAMPLERATE;
-        key_duration = KEY3_DURATION;
-        key_offset = KEY3_OFFSET;
-        break;
-      case 4:
-        key_size = KEY4_SIZE;
-        key_samplerate = KEY4_SAMPLERATE;
-        key_duration = KEY4_DURATION;
-        key_offset = KEY4_OFFSET;
-        break;
-      default:
-        key_size = KEY1_SIZE;
-        key_samplerate = KEY1_SAMPLERATE;
-        key_duration = KEY1_DURATION;
-    }
-    ft.playAudio(key_offset, key_size, key_samplerate, FT81x_AUDIO_FORMAT_ULAW, false);
-    delay(key_duration);
-    ft.stopSound();
-  }
-
-  ft.drawBitmap(0, 8, 8, LOGO_WIDTH, LOGO_HEIGHT, 4, 0);  // logo scaled 4x
-  if (hw_setup.ft_char) {
-    ft.overlayBitmap(LOGO_BITMAP_SIZE, ft.width()-BG_WIDTH-8, ft.height()-BG_HEIGHT-8, BG_WIDTH, BG_HEIGHT, 1, 0); // bg image
+    const ft_key_sound_t *snd = &ft_key_sounds[(hw_setup.ft_sound <= 4) ? hw_setup.ft_sound-1 : 0];
+    uint32_t key_offset = app_core_browser_ft_sound(snd);
+    // stopped from the main loop (ft.tick()), the core starts loading meanwhile
+    ft.playClip(key_offset, snd->size, snd->samplerate, FT81x_AUDIO_FORMAT_ULAW, snd->duration);
   }
 
   ft.swapScreen();
@@ -251,14 +344,14 @@ void app_core_browser_read_list() {
   autoload_enabled = false;
   // pre-select autoload core
   for (uint8_t i=0; i<cores_len; i++) {
-    String s1 = String(hw_setup.autoload_core);
-    String s2 = String(cores[i].id);
-    s1.trim();
-    s2.trim();
+    char s1[sizeof(hw_setup.autoload_core)];
+    char s2[sizeof(cores[i].id)];
+    str_copy(s1, sizeof(s1), hw_setup.autoload_core); str_trim(s1);
+    str_copy(s2, sizeof(s2), cores[i].id); str_trim(s2);
 //    d_println(s1);
 //    d_println(s2);
 //    d_println(hw_setup.autoload_enabled);
-    if (!autoload_enabled && hw_setup.autoload_enabled && s2.equals(s1)) {
+    if (!autoload_enabled && hw_setup.autoload_enabled && strcmp(s2, s1) == 0) {
       autoload_enabled = true;
       autoload_countdown = hw_setup.autoload_timeout;
       core_sel = i;
@@ -268,7 +361,28 @@ void app_core_browser_read_list() {
 
 }
 
+// first core whose name starts with the typed prefix, the list is in menu order so it is a plain scan
+uint8_t app_core_browser_find(const char *prefix) {
+  size_t n = strlen(prefix);
+  for (uint8_t i=0; i<cores_len; i++) {
+    if (strncasecmp(cores[i].name, prefix, n) == 0) {
+      return i;
+    }
+  }
+  return core_sel;
+}
+
 void app_core_browser_on_keyboard() {
+      // type-ahead search, S / V / P / Space keep their actions unless a search is in progress or shift is held
+      uint8_t key = usb_keyboard_report.keycode[0];
+      bool shift = usb_keyboard_report.modifier & (KEY_MOD_LSHIFT | KEY_MOD_RSHIFT);
+      bool hotkey = (key == KEY_S || key == KEY_V || key == KEY_P);
+      bool search = cores_len > 0 && (!hotkey || shift || typeahead_active(&core_search)) && typeahead_key(&core_search, key);
+      if (search) {
+        autoload_enabled = false;
+        core_sel = app_core_browser_find(core_search.prefix);
+      }
+
       if (cores_len > 0) {
         // down
         if (usb_keyboard_report.keycode[0] == KEY_DOWN || (joyL & SC_BTN_DOWN) || (joyR & SC_BTN_DOWN)) {
@@ -317,8 +431,8 @@ void app_core_browser_on_keyboard() {
             app_core_browser_ft_menu(2); // play wav
           }
           d_printf("Selected core %s to boot from menu", cores[core_sel].filename); d_println();
-          String f = String(cores[core_sel].filename); f.trim(); 
-          char buf[32]; f.toCharArray(buf, sizeof(buf));
+          char buf[sizeof(cores[core_sel].filename)];
+          str_copy(buf, sizeof(buf), cores[core_sel].filename); str_trim(buf);
           has_ft = false;
           do_configure(buf);
           switch (core.type) {
@@ -329,7 +443,7 @@ void app_core_browser_on_keyboard() {
           }
         }
 
-        if (usb_keyboard_report.keycode[0] == KEY_V && hw_setup.debug_enabled && hw_setup.ft_enabled && has_ft) {
+        if (usb_keyboard_report.keycode[0] == KEY_V && !search && hw_setup.debug_enabled && hw_setup.ft_enabled && has_ft) {
           autoload_enabled = false;
           uint8_t old_vmode = hw_setup.ft_video_mode;
           hw_setup.ft_video_mode++;
@@ -341,8 +455,16 @@ void app_core_browser_on_keyboard() {
           app_core_browser_ft_overlay();
         }
 
+        // dump core switch profile, event ring counters and loop latency to serial
+        if (usb_keyboard_report.keycode[0] == KEY_P && !search && hw_setup.debug_enabled) {
+          autoload_enabled = false;
+          prof_dump();
+          spi_events_dump();
+          sched_dump();
+        }
+
         // enter setup mode
-        if (usb_keyboard_report.keycode[0] == KEY_S) {
+        if (usb_keyboard_report.keycode[0] == KEY_S && !search) {
           autoload_enabled = false;
           has_ft = false;
           ft.vga(false);
@@ -362,7 +484,7 @@ void app_core_browser_on_keyboard() {
       }
 
       // return back to classic osd
-      if (usb_keyboard_report.keycode[0] == KEY_SPACE && has_ft == true && hw_setup.ft_enabled) {
+      if (usb_keyboard_report.keycode[0] == KEY_SPACE && !search && has_ft == true && hw_setup.ft_enabled) {
         has_ft = false;
         ft.vga(false);
         ft.spi(false);
@@ -374,8 +496,8 @@ void app_core_browser_on_time() {
   if (autoload_enabled) {
     if (autoload_timer.elapsed() > autoload_countdown * 1000) {
       autoload_enabled = false;
-      String f = String(cores[core_sel].filename); f.trim(); 
-      char buf[32]; f.toCharArray(buf, sizeof(buf));
+      char buf[sizeof(cores[core_sel].filename)];
+      str_copy(buf, sizeof(buf), cores[core_sel].filename); str_trim(buf);
       has_ft = false;
       do_configure(buf);
       switch (core.type) {
@@ -17,6 +17,7 @@ void app_core_browser_ft_menu(uint8_t play_sounds);
 core_list_item_t app_core_browser_get_item();
 void app_core_browser_read_list();
 
+uint8_t app_core_browser_find(const char *prefix);
 void app_core_browser_on_keyboard();
 
 void app_core_browser_on_time();
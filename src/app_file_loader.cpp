@@ -11,30 +11,346 @@
 #include "app_file_loader.h"
 #include <SPI.h>
 #include "sorts.h"
+#include "spi_stream.h"
+#include "strutil.h"
+#include "file_index.h"
+#include "collate.h"
+#include "typeahead.h"
+
+static typeahead_t file_search;
+
+#define FILE_ID_NONE 0xFFFF
+
+// progressive directory scan: the list fills in dir order while the menu is
+// already usable, and is sorted and saved to the index once complete.
+// Up to SORT_FILES_MAX entries are sorted in files[] as they are; a longer
+// list is scanned again as sort records, sorted in runs on the card and
+// merged into the index (see file_index.cpp). When the card cannot take
+// the runs, the list is scanned once more and cut at SORT_FILES_MAX.
+// A list with an index is read from it the same way, a slice at a time,
+// and only scanned when the dir turns out to have changed since.
+static struct {
+  bool active;
+  bool indexed; // files[] is read from the index, then the dir is fingerprinted to check it
+  bool runs; // files[] holds sort records, full ones go to the card as runs
+  bool merging; // runs go into the index, files[] is the merge buffer meanwhile
+  bool truncated; // runs failed, the list stops at SORT_FILES_MAX and is not saved
+  uint32_t pos; // root1 position of the next dir entry
+  uint32_t drawn; // millis() of the last menu redraw
+  uint16_t sel_id; // entry the user had moved to before the view started over
+  bool autoload; // the last loaded file is loaded once the list is sorted, unless a key comes first
+  file_index_t idx;
+  ext_sort_t sort; // runs of FILE_RECS_MAX records for longer lists
+} file_scan;
+
+// while scanning runs files[] holds sort records, the list is in dir order then
+static file_sort_rec_t * const file_recs = (file_sort_rec_t *) files;
+#define FILE_RECS_MAX (sizeof(files) / sizeof(file_sort_rec_t))
+
+// lists longer than SORT_FILES_MAX stay in the index file, files[] holds
+// their key samples (see file_index.cpp) and a window of them, otherwise
+// files[] is the whole list
+#define FILE_WINDOW_LEN (SORT_FILES_MAX - FILE_INDEX_SAMPLES)
+
+static struct {
+  bool paged;
+  uint16_t from; // list position of the first window entry
+  uint16_t len; // valid entries in the window
+} file_window;
+
+// list entry i, the window around it is read in first when the list is paged
+static const file_list_sort_item_t* app_file_loader_item(uint16_t i) {
+  static const file_list_sort_item_t none = {};
+  static file_list_sort_item_t scanned;
+  if (file_scan.runs) {
+    memcpy(&scanned, &file_recs[i], sizeof(scanned));
+    return &scanned;
+  }
+  if (!file_window.paged) {
+    return &files[i];
+  }
+  file_list_sort_item_t *window = files + FILE_INDEX_SAMPLES;
+  if (i < file_window.from || i >= file_window.from + file_window.len) {
+    uint16_t from = i > FILE_WINDOW_LEN/2 ? i - FILE_WINDOW_LEN/2 : 0;
+    if (from > files_len - FILE_WINDOW_LEN) from = files_len - FILE_WINDOW_LEN;
+    file_window.len = 0;
+    if (!file_index_read(&file_scan.idx, from, window, FILE_WINDOW_LEN)) {
+      d_printf("Unable to read file index %s", file_scan.idx.path); d_println();
+      return &none;
+    }
+    file_window.from = from;
+    file_window.len = FILE_WINDOW_LEN;
+  }
+  return &window[i - file_window.from];
+}
 
-void app_file_loader_read_list(bool forceIndex = false) {
+// list position of a file, a paged list is read through window by window
+static bool app_file_loader_index_of(uint16_t file_id, uint16_t *pos) {
+  for (uint16_t i=0; i<files_len; i++) {
+    if (app_file_loader_item(i)->file_id == file_id) {
+      *pos = i;
+      return true;
+    }
+  }
+  return false;
+}
 
-  zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
-  zxosd.frame(8,8,24,12, 1);
-  zxosd.fill(9,9,23,11, 32);
-  zxosd.setColor(OSD::COLOR_GREEN_I, OSD::COLOR_BLACK);
-  zxosd.setPos(9, 9);
-  zxosd.print("Scanning files");
-  zxosd.setColor(OSD::COLOR_MAGENTA_I, OSD::COLOR_BLACK);
-  zxosd.setPos(9,10);
-  zxosd.print("Please wait...");
-  zxosd.update();
-  delay(100);
+// (re)starts the scan at the first dir entry, as list entries or as sort records
+static void app_file_loader_scan_begin(bool runs) {
+  if (file_sel > 0) file_scan.sel_id = app_file_loader_item(file_sel)->file_id;
+  root1.rewind();
+  file_scan.pos = root1.curPosition();
+  file_scan.active = true;
+  file_scan.runs = runs;
+  files_len = 0;
+  file_sel = 0;
+  cached_file_from = cached_file_to = 0xFFFF;
+  if (runs) {
+    file_index_sort_begin(&file_scan.sort, &root1, file_recs, FILE_RECS_MAX);
+  }
+}
+
+// the card could not take the runs: the list is read once more, up to SORT_FILES_MAX
+static void app_file_loader_scan_truncate() {
+  d_printf("Unable to sort file list on the card, list truncated to %u files", SORT_FILES_MAX); d_println();
+  file_index_sort_abort(&file_scan.idx);
+  file_scan.merging = false;
+  file_scan.truncated = true;
+  app_file_loader_scan_begin(false);
+}
+
+// reads dir entries until the slice time is used up,
+// returns true when the whole directory has been read
+static bool app_file_loader_scan_slice() {
+  uint32_t start = time_us_32();
+  bool more = true;
+  // page names are opened by index in between slices, so the dir position is kept here
+  root1.seekSet(file_scan.pos);
+  while ((more = file1.openNext(&root1, O_RDONLY))) {
+    char filename[14]; file1.getSFN(filename, sizeof(filename));
+    bool match = !file1.isDirectory() && path_ext_match(core.file_extensions, filename);
+    if (match && !file_scan.runs && files_len == SORT_FILES_MAX) {
+      file1.close();
+      if (file_scan.truncated) {
+        more = false;
+        break;
+      }
+      // one more than fits, the list is read again for the runs
+      app_file_loader_scan_begin(true);
+      return false;
+    }
+    if (match) {
+      char name[255]; file1.getName(name, sizeof(name));
+      if (file_scan.runs) {
+        collate_key(file_recs[files_len].key, SORT_REC_KEY_LEN, name);
+        file_recs[files_len].file_id = file1.dirIndex();
+      } else {
+        collate_key(files[files_len].key, SORT_KEY_LEN, name);
+        files[files_len].file_id = file1.dirIndex();
+      }
+      files_len++;
+    }
+    file1.close();
+    // a full buffer of records goes to the card as a sorted run, the view starts over with the next one
+    if (file_scan.runs && files_len == FILE_RECS_MAX) {
+      if (file_sel > 0) file_scan.sel_id = file_recs[file_sel].file_id;
+      if (!file_index_sort_spill(&file_scan.sort, files_len)) {
+        app_file_loader_scan_truncate();
+        return false;
+      }
+      files_len = 0;
+      file_sel = 0;
+      cached_file_from = cached_file_to = 0xFFFF;
+    }
+    if (time_us_32() - start >= FILE_SCAN_SLICE_US) {
+      break;
+    }
+  }
+  file_scan.pos = root1.curPosition();
+  return !more;
+}
+
+static void app_file_loader_select_last() {
+  // select and load prev file on boot
+  uint16_t pos;
+  if (has_sd && files_len > 0 && core.last_file_id > 0 && app_file_loader_index_of(core.last_file_id, &pos)) {
+    file_sel = pos;
+    if (file1.open(&root1, core.last_file_id)) {
+      app_file_loader_send_file(core.last_file_id);
+      file1.close();
+    }
+    // hide osd
+    if (!is_osd_hiding) {
+      is_osd_hiding = true;
+      hide_timer.reset();
+      zxosd.hideMenu();
+    }
+  }
+}
+
+// keeps the entry the user has moved to in the sorted list, otherwise the
+// last loaded file is picked up if still pending; the cached page names are
+// stale either way
+static void app_file_loader_reselect(uint16_t sel_id) {
+  uint16_t pos;
+  cached_file_from = cached_file_to = 0xFFFF;
+  if (sel_id == FILE_ID_NONE) {
+    file_sel = 0;
+    if (file_scan.autoload) {
+      file_scan.autoload = false;
+      app_file_loader_select_last();
+    }
+  } else {
+    file_sel = app_file_loader_index_of(sel_id, &pos) ? pos : 0;
+  }
+}
+
+static void app_file_loader_scan_done() {
+  uint16_t sel_id = file_sel > 0 ? app_file_loader_item(file_sel)->file_id : file_scan.sel_id;
+  file_index_fingerprint(&file_scan.idx, &root1);
+
+  // runs on the card: the last one joins them, the merge into the index
+  // goes on from app_file_loader_on_scan() and the list is paged from there
+  if (file_scan.runs) {
+    file_scan.sel_id = sel_id;
+    if (!file_index_sort_spill(&file_scan.sort, files_len) || !file_index_sort_merge(&file_scan.idx, &file_scan.sort)) {
+      app_file_loader_scan_truncate();
+      return;
+    }
+    files_len = 0;
+    file_sel = 0;
+    cached_file_from = cached_file_to = 0xFFFF;
+    file_scan.runs = false;
+    file_scan.merging = true;
+    return;
+  }
+
+  // sort by file name, the unused rest of files[] is scratch for the tied names
+  std::sort(files, files + files_len);
+  file_index_sort_ties(&root1, files, files_len, files + files_len, (SORT_FILES_MAX - files_len) * sizeof(files[0]));
+  file_scan.active = false;
+
+  d_printf("Read file list: %u files", files_len); d_println();
+  // a truncated list is scanned again next time, the card may take the runs by then
+  if (!file_scan.truncated && !file_index_save(&file_scan.idx, files, files_len)) {
+    d_printf("Unable to write file index %s", file_scan.idx.path); d_println();
+  }
+  app_file_loader_reselect(sel_id);
+}
+
+// merges runs for the slice time, returns true once the index is complete or failed
+static bool app_file_loader_merge_slice() {
+  uint32_t start = time_us_32();
+  do {
+    if (!file_index_sort_step(&file_scan.idx, &file_scan.sort)) {
+      return true;
+    }
+  } while (!file_scan.sort.done && time_us_32() - start < FILE_SCAN_SLICE_US);
+  return file_scan.sort.done;
+}
+
+static void app_file_loader_merge_done() {
+  files_len = 0;
+  if (!file_scan.sort.done || !file_index_load(&file_scan.idx, files, SORT_FILES_MAX, &files_len)) {
+    app_file_loader_scan_truncate();
+    return;
+  }
+  file_scan.active = false;
+  file_scan.merging = false;
+  file_window.paged = files_len > SORT_FILES_MAX;
+  file_window.len = 0;
+  d_printf("Read file list: %u files, %lu runs", files_len, (unsigned long) ext_sort_runs(&file_scan.sort)); d_println();
+  app_file_loader_reselect(file_scan.sel_id);
+}
+
+// the index did not load or is out of date: the dir is scanned after all,
+// the user stays on the entry they moved to
+static void app_file_loader_index_rescan() {
+  d_printf("File index %s is out of date, scanning file list", file_scan.idx.path); d_println();
+  app_file_loader_scan_begin(false);
+  file_scan.indexed = false;
+  file_window.paged = false;
+  file_window.len = 0;
+  file_index_close(&file_scan.idx);
+}
+
+// reads the index, then fingerprints the dir, for the slice time; returns
+// true once both are done or the index failed to load
+static bool app_file_loader_index_slice() {
+  uint32_t start = time_us_32();
+  file_index_t *idx = &file_scan.idx;
+  do {
+    if (idx->loaded < idx->count) {
+      if (!file_index_load_step(idx, files, SORT_FILES_MAX)) {
+        file_scan.indexed = false;
+        return true;
+      }
+      if (!file_window.paged) files_len = idx->loaded;
+    } else if (file_index_fingerprint_step(idx, &root1)) {
+      return true;
+    }
+  } while (time_us_32() - start < FILE_SCAN_SLICE_US);
+  return false;
+}
+
+static void app_file_loader_index_done() {
+  if (!file_scan.indexed || !file_index_current(&file_scan.idx)) {
+    app_file_loader_index_rescan();
+    return;
+  }
+  file_scan.indexed = false;
+  file_scan.active = false;
+  d_printf("Read file list from %s: %u files", file_scan.idx.path, files_len); d_println();
+  if (file_scan.autoload) {
+    file_scan.autoload = false;
+    app_file_loader_select_last();
+  }
+}
+
+// continues a progressive scan, called from the main loop scheduler
+void app_file_loader_on_scan() {
+  if (!file_scan.active) {
+    return;
+  }
+  // the file list belongs to the osd core browser after a core switch
+  if (core.type != CORE_TYPE_FILELOADER || !root1.isOpen()) {
+    file_index_sort_abort(&file_scan.idx);
+    file_scan.active = false;
+    file_scan.indexed = false;
+    file_scan.runs = false;
+    file_scan.merging = false;
+    return;
+  }
+  if (file_scan.indexed) {
+    if (app_file_loader_index_slice()) {
+      app_file_loader_index_done();
+    } else if (millis() - file_scan.drawn < FILE_SCAN_DRAW_MS) {
+      return;
+    }
+  } else if (file_scan.merging) {
+    if (app_file_loader_merge_slice()) {
+      app_file_loader_merge_done();
+    } else if (millis() - file_scan.drawn < FILE_SCAN_DRAW_MS) {
+      return;
+    }
+  } else if (app_file_loader_scan_slice()) {
+    app_file_loader_scan_done();
+  } else if (millis() - file_scan.drawn < FILE_SCAN_DRAW_MS) {
+    return;
+  }
+  file_scan.drawn = millis();
+  if (osd_state == state_file_loader) {
+    app_file_loader_menu(APP_COREBROWSER_MENU_OFFSET);
+  }
+}
+
+void app_file_loader_read_list(bool forceIndex = false) {
 
   // files from sd1 card
 
   if (has_sd) {
-    String dir = String(core.dir);
-    dir.trim();
-    if (dir.length() == 0) dir = "/";
-    if (dir.charAt(0) != '/') dir = "/" + dir;
     char d[256];
-    dir.toCharArray(d, 255);
+    path_dir(d, sizeof(d), core.dir);
     if (root1.isOpen()) {
       root1.close();
     }
@@ -50,32 +366,66 @@ void app_file_loader_read_list(bool forceIndex = false) {
         char b[255];
         sprintf(b, "Bad dir %s", d); 
         zxosd.print(b);
-        zxosd.update();
+        zxosd.update(true);
         delay(1000);
         app_file_loader_read_list(forceIndex);
         return;
     }
     root1.rewind();
 
-    d_println("Read file list");
+    // cleanup error messages
+    zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
+    zxosd.fill(8,8,24,12, 32);
+    zxosd.update();
+
+    // an unfinished scan or merge of the previous list is dropped
+    if (file_scan.active) {
+      file_index_sort_abort(&file_scan.idx);
+    }
     files_len = 0;
     file_sel = 0;
-    memset(files, 0, sizeof(files));
-    String exts = String(core.file_extensions);
-    exts.toLowerCase(); exts.trim();
-    char e[33];
-    exts.toCharArray(e, 32);
-    while (file1.openNext(&root1, O_RDONLY)) {
-      char filename[14]; file1.getSFN(filename, sizeof(filename));
-      uint8_t len = strlen(filename);
-      if (!file1.isDirectory() && files_len < SORT_FILES_MAX) {
-        if (exts.length() == 0 || exts.indexOf(strlwr(filename + (len - 4))) != -1) {
-          memcpy(files[files_len].hash, filename, SORT_HASH_LEN);
-          files[files_len].file_id = file1.dirIndex();
-          files_len++;
-        }
+    file_scan.active = false;
+    file_scan.indexed = false;
+    file_scan.runs = false;
+    file_scan.merging = false;
+    file_scan.truncated = false;
+    file_scan.sel_id = FILE_ID_NONE;
+    file_scan.autoload = false;
+    file_window.paged = false;
+    file_window.from = 0;
+    file_window.len = 0;
+    cached_file_from = cached_file_to = 0xFFFF;
+
+    // sorted list from the sidecar index (R forces a rescan): the first
+    // slice of it now, drawn with whatever it has read, the rest and the
+    // check that the dir is unchanged from app_file_loader_on_scan(); the
+    // last file is loaded once the index is found current
+    file_index_open(&file_scan.idx, d, core.file_extensions);
+    if (!forceIndex && file_index_load_begin(&file_scan.idx, SORT_FILES_MAX)) {
+      file_window.paged = file_scan.idx.count > SORT_FILES_MAX;
+      files_len = file_window.paged ? file_scan.idx.count : 0;
+      file_index_fingerprint_begin(&file_scan.idx, &root1);
+      file_scan.active = true;
+      file_scan.indexed = true;
+      file_scan.autoload = true;
+      file_scan.drawn = millis();
+      if (app_file_loader_index_slice()) {
+        app_file_loader_index_done();
       }
-      file1.close();
+      return;
+    } else {
+      // first slice now, drawn with whatever it has listed, the rest from
+      // app_file_loader_on_scan(); the last file is loaded after the sort
+      // unless the user takes over before, or asked for the rescan (R)
+      d_println("Scanning file list");
+      memset(files, 0, sizeof(files));
+      file_scan.drawn = millis();
+      app_file_loader_scan_begin(false);
+      file_scan.autoload = !forceIndex;
+      if (app_file_loader_scan_slice()) {
+        app_file_loader_scan_done();
+      }
+      return;
     }
 
   } else {
@@ -87,42 +437,11 @@ void app_file_loader_read_list(bool forceIndex = false) {
     zxosd.print("Error occured");
     zxosd.setPos(9,10);
     zxosd.print("Check SD card");
-    zxosd.update();
+    zxosd.update(true);
     delay(1000);
     app_file_loader_read_list(forceIndex);
     return;
   }
-
-  // sort by file name
-  std::sort(files, files + files_len);
-  
-  // cleanup error messages
-  if (has_sd) {
-    zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
-    zxosd.fill(8,8,24,12, 32);
-    zxosd.update();
-  }
-
-  // select and load prev file on boot
-  if (has_sd && files_len > 0 && core.last_file_id > 0) {
-    //d_printf("Looking for last file id = %d", core.last_file_id); d_println();
-    for (uint16_t i=0; i<files_len; i++) {
-      if (core.last_file_id == files[i].file_id) {
-          file_sel = i;
-          //d_printf("Found %d pos", i); d_println();
-          if (file1.open(&root1, core.last_file_id)) {
-            app_file_loader_send_file(core.last_file_id);
-            file1.close();
-          }
-          // hide osd
-          if (!is_osd_hiding) {
-            is_osd_hiding = true;
-            hide_timer.reset();
-            zxosd.hideMenu();
-          }
-      }
-    }
-  }
 }
 
 void app_file_loader_menu(uint8_t vpos) {
@@ -152,22 +471,11 @@ void app_file_loader_menu(uint8_t vpos) {
       // get name from filename and put into cache
       else {
 
-        if (file1.open(&root1, files[i].file_id)) {
+        if (file1.open(&root1, app_file_loader_item(i)->file_id)) {
           char filename[255];
           file1.getName(filename, sizeof(filename));
-          String exts = String(core.file_extensions); exts.toLowerCase(); exts.trim();
-          String f(filename);
-          /*f.replace("_", " ");
-          f.replace("-", " ");
-          f.replace("[!]", "");
-          f.replace("  ", " "); f.replace("  ", " ");
-          if (exts.indexOf(f.substring(f.length()-4)) != -1) {
-            f.replace(f.substring(f.length()-4), "");
-          }
-          f.trim();*/
-          f.toCharArray(name, sizeof(name));
-          f.toCharArray(cached_names[j].name, sizeof(cached_names[j].name));
-          cached_names[j].name[32] = '\0';
+          str_copy(name, sizeof(name), filename);
+          str_copy(cached_names[j].name, sizeof(cached_names[j].name), filename);
           file1.close();
         }
       }
@@ -196,7 +504,15 @@ void app_file_loader_menu(uint8_t vpos) {
   }
   zxosd.setPos(8, vpos + file_page_size + 1); zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
   char b[40];
-  sprintf(b, "Page %03d of %03d", file_page, file_pages); 
+  if (file_scan.indexed && file_scan.idx.loaded < file_scan.idx.count) {
+    sprintf(b, "Loading... %3lu%%      ", (unsigned long) file_scan.idx.loaded * 100 / file_scan.idx.count);
+  } else if (file_scan.merging) {
+    sprintf(b, "Sorting... %3lu%%      ", (unsigned long) (file_scan.sort.merged * 100 / file_scan.sort.total));
+  } else if (file_scan.active && !file_scan.indexed) {
+    sprintf(b, "Scanning... %-8lu", (unsigned long) (file_scan.runs ? file_scan.sort.total + files_len : files_len));
+  } else {
+    sprintf(b, "Page %03d of %03d     ", file_page, file_pages);
+  }
   zxosd.print(b);
   zxosd.update();
 }
@@ -235,7 +551,7 @@ void app_file_loader_save()
       d_println("File is not writable");
       return;
     }
-    core.last_file_id = files[file_sel].file_id;
+    core.last_file_id = app_file_loader_item(file_sel)->file_id;
     file_write16(FILE_POS_FILELOADER_FILE, core.last_file_id);
     file1.close();
 }
@@ -243,20 +559,15 @@ void app_file_loader_save()
 void app_file_loader_send_file(uint16_t file_id) {
 
   zxosd.loadingPopup();
-  zxosd.update();
+  zxosd.update(true);
 
   if (root1.isOpen()) {
     root1.close();
   }
 
   if (!root1.isOpen()) {
-    String dir = String(core.dir);
-    dir.trim();
-    if (dir.length() == 0) dir = "/";
-    if (dir.charAt(0) != '/') dir = "/" + dir;
-    //sd1.chdir(dir);
     char dirname[255];
-    dir.toCharArray(dirname, sizeof(dirname));
+    path_dir(dirname, sizeof(dirname), core.dir);
     if (!root1.open(&sd1, dirname)) {
       d_printf("Unable to open dir %s", dirname); d_println();
       return;
@@ -276,7 +587,7 @@ void app_file_loader_send_file(uint16_t file_id) {
     return;
   }
 
-  uint8_t buf[512];
+  uint8_t *buf;
   int c;
 
   // trigger reset
@@ -291,20 +602,21 @@ void app_file_loader_send_file(uint16_t file_id) {
 uint32_t cnt = 0;
 uint32_t c1 = 0;
 
-  while(c = file1.read(buf, sizeof(buf))) {
-    for (int j=0; j<c; j++) {
-      app_file_loader_send_byte(cnt, buf[j]);
-      cnt++;
-      c1++;
-      if (c1 == 16384) {
-        c1 = 0;
-        zxosd.loadingPopup(cnt, file_size);
-        zxosd.update();
-      }
+  // sectors go from sd to the stream ring and then to the fpga by dma
+  spi_stream_begin(CMD_FILEBANK, CMD_FILEDATA, 0);
+  while((c = file1.read(buf = spi_stream_acquire(), SPI_STREAM_BUF_SIZE)) > 0) {
+    spi_stream_commit(buf, c);
+    cnt += c;
+    c1 += c;
+    if (c1 >= 16384) {
+      c1 = 0;
+      zxosd.loadingPopup(cnt, file_size);
+      zxosd.update(true);
     }
   }
+  spi_stream_end();
   zxosd.loadingPopup(file_size, file_size);
-  zxosd.update();
+  zxosd.update(true);
   
   // 00 - active = 0, reset = 0
   spi_send(CMD_FILELOADER, 0, 0);
@@ -317,9 +629,80 @@ uint32_t c1 = 0;
   app_file_loader_overlay(false, false);
 }
 
+// collate_seek_fn over the sorted list: a binary search of files[] as a
+// whole, or of the key samples of a paged list, then of the one block of the
+// index file between two of them; names are only read where the key bytes
+// of the entries tie with the prefix (see collate_lower_bound())
+static void app_file_loader_seek(void *ctx, const uint8_t *key, size_t n, size_t *pos, uint8_t *found) {
+  if (!file_window.paged) {
+    *pos = collate_lower_bound(files, files_len, sizeof(files[0]), key, n, found, file_index_name, &root1);
+    return;
+  }
+  // every sample before lo is below the prefix, so is the entry it starts a block with
+  uint16_t step = file_scan.idx.step;
+  uint16_t samples = (files_len + step - 1) / step;
+  uint16_t lo = collate_lower_bound(files, samples, sizeof(files[0]), key, n, found, file_index_name, &root1);
+  file_list_sort_item_t block[(0xFFFF + FILE_INDEX_SAMPLES - 1) / FILE_INDEX_SAMPLES];
+  uint16_t from = 0, len = 0;
+  if (lo > 0) {
+    from = (lo - 1) * step + 1;
+    len = ((uint32_t) lo * step < files_len ? lo * step : files_len) - from;
+  }
+  if (len > 0 && !file_index_read(&file_scan.idx, from, block, len)) {
+    *pos = file_sel;
+    memset(found, 0, n);
+    return;
+  }
+  // past the block it is sample lo, found holds its key already
+  uint8_t k[COLLATE_PREFIX_MAX];
+  uint16_t i = collate_lower_bound(block, len, sizeof(block[0]), key, n, k, file_index_name, &root1);
+  *pos = from + i;
+  if (i < len) memcpy(found, k, n);
+}
+
+// first entry at or after the typed prefix (see collate_find())
+uint16_t app_file_loader_find(const char *prefix) {
+  // a paged list is searched by its key samples, so once they are all read
+  if (file_scan.indexed && file_window.paged && file_scan.idx.loaded < file_scan.idx.count) {
+    return file_sel;
+  }
+  // not sorted yet while scanning, first listed match on the key it has then
+  if (file_scan.active && !file_scan.indexed) {
+    uint8_t key[COLLATE_PREFIX_MAX];
+    size_t at;
+    size_t n = collate_prefix_key(key, sizeof(key), prefix, &at);
+    uint8_t first = at != (size_t) -1 ? key[at] : 0, last = at != (size_t) -1 ? '9' : 0;
+    size_t m = file_scan.runs ? SORT_REC_KEY_LEN : SORT_KEY_LEN;
+    if (m > n) m = n;
+    for (uint16_t i=0; i<files_len; i++) {
+      const uint8_t *k = file_scan.runs ? file_recs[i].key : files[i].key;
+      for (uint8_t l=first; l<=last; l++) {
+        if (at != (size_t) -1) key[at] = l;
+        if (memcmp(k, key, m) == 0) {
+          return i;
+        }
+      }
+    }
+    return file_sel;
+  }
+  size_t pos = collate_find(prefix, app_file_loader_seek, nullptr);
+  return pos < files_len ? pos : files_len-1;
+}
+
 void app_file_loader_on_keyboard() 
 {
+          // the user is browsing, a list still being read does not load the last file any more
+          file_scan.autoload = false;
+
           if (files_len > 0) {
+        // type-ahead search, R keeps rebuilding the index unless a search is in progress or shift is held
+        uint8_t key = usb_keyboard_report.keycode[0];
+        bool shift = usb_keyboard_report.modifier & (KEY_MOD_LSHIFT | KEY_MOD_RSHIFT);
+        bool search = (key != KEY_R || shift || typeahead_active(&file_search)) && typeahead_key(&file_search, key);
+        if (search) {
+          file_sel = app_file_loader_find(file_search.prefix);
+        }
+
         // down
         if (usb_keyboard_report.keycode[0] == KEY_DOWN || (joyL & SC_BTN_DOWN) || (joyR & SC_BTN_DOWN)) {
           if (file_sel < files_len-1) {
@@ -357,15 +740,16 @@ void app_file_loader_on_keyboard()
         }
 
         // R = recreate file index
-        if (usb_keyboard_report.keycode[0] == KEY_R) {
+        if (usb_keyboard_report.keycode[0] == KEY_R && !search && !shift) {
             file_sel = 0;
+            typeahead_reset(&file_search);
             app_file_loader_overlay(true, true);
         }
         
         // enter
         if (usb_keyboard_report.keycode[0] == KEY_ENTER || (joyL & SC_BTN_A) || (joyR & SC_BTN_A) || (joyL & SC_BTN_B) || (joyR & SC_BTN_B)) {
           app_file_loader_save();
-          app_file_loader_send_file(files[file_sel].file_id);
+          app_file_loader_send_file(app_file_loader_item(file_sel)->file_id);
           // hide osd
           if (!is_osd_hiding) {
             is_osd_hiding = true;
@@ -381,19 +765,5 @@ void app_file_loader_on_keyboard()
       }
 }
 
-void app_file_loader_send_byte(uint32_t addr, uint8_t data) {
-  // send file bank address every 256 bytes
-  if ((addr & 0x000000FF) == 0) {
-    uint8_t filebank3 = (uint8_t)((addr & 0xFF000000) >> 24);
-    uint8_t filebank2 = (uint8_t)((addr & 0x00FF0000) >> 16);
-    uint8_t filebank1 = (uint8_t)((addr & 0x0000FF00) >> 8);
-    //d_printf("File bank %d %d %d", filebank1, filebank2, filebank3); d_println();
-    spi_send(CMD_FILEBANK, 0, filebank1);
-    spi_send(CMD_FILEBANK, 1, filebank2);
-    spi_send(CMD_FILEBANK, 2, filebank3);
-  }
-  // send lower 256 bytes
-  uint8_t fileaddr = (uint8_t)((addr & 0x000000FF));
-  spi_send(CMD_FILEDATA, fileaddr, data);
-}
+
 
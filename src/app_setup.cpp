@@ -34,9 +34,7 @@ void app_setup_overlay() {
   setup_menu.setFastCursor(false);
 
   setup_menu.onPrint([](const char* str, size_t len) {
-      String s = String(str, len);
-      zxosd.print(s);
-      zxosd.update();
+      zxosd.write((const uint8_t*) str, len);
   });
 
   setup_menu.onCursor([](uint8_t row, bool choosen, bool active) -> uint8_t {
@@ -48,7 +46,6 @@ void app_setup_overlay() {
                        (choosen && active ) ? OSD::COLOR_FLASH : 
                        OSD::COLOR_BLACK;
     zxosd.setColor(color, bg_color);
-    zxosd.update();
     return 0;
   });
 
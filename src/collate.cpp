@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include "collate.h"
+
+typedef struct {
+  const char *p; // next name char
+  const char *run; // end of the digit run being copied, or NULL
+} collate_t;
+
+// next key byte of the name, 0 once it is used up
+static uint8_t collate_next(collate_t *c) {
+  if (c->run) {
+    if (c->p < c->run) return *c->p++;
+    c->run = NULL;
+  }
+  char ch = *c->p;
+  if (!ch) return 0;
+  if (ch >= '0' && ch <= '9') {
+    // strip leading zeros, keep one for an all zero run
+    while (*c->p == '0' && c->p[1] >= '0' && c->p[1] <= '9') c->p++;
+    const char *e = c->p;
+    while (*e >= '0' && *e <= '9') e++;
+    size_t n = e - c->p;
+    c->run = e;
+    return '0' + (n > 9 ? 9 : n);
+  }
+  c->p++;
+  return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+// len key bytes of the name from key byte from on, zero padded
+static size_t collate_window(uint8_t *key, size_t len, const char *name, size_t from) {
+  collate_t c = {name, NULL};
+  while (from > 0 && collate_next(&c) != 0) from--;
+  size_t i = 0;
+  uint8_t b;
+  while (from == 0 && i < len && (b = collate_next(&c)) != 0) key[i++] = b;
+  if (i < len) memset(key + i, 0, len - i);
+  return i;
+}
+
+size_t collate_key(uint8_t *key, size_t len, const char *name) {
+  return collate_window(key, len, name, 0);
+}
+
+int collate_cmp(const char *a, const char *b) {
+  collate_t ca = {a, NULL}, cb = {b, NULL};
+  for (;;) {
+    uint8_t x = collate_next(&ca), y = collate_next(&cb);
+    if (x != y) return x < y ? -1 : 1;
+    if (x == 0) return 0;
+  }
+}
+
+// key bytes two names have in common
+static size_t collate_common(const char *a, const char *b) {
+  collate_t ca = {a, NULL}, cb = {b, NULL};
+  size_t n = 0;
+  for (;;) {
+    uint8_t x = collate_next(&ca), y = collate_next(&cb);
+    if (x != y || x == 0) return n;
+    n++;
+  }
+}
+
+static size_t collate_tie_len; // window bytes of the records being sorted
+
+static uint16_t collate_id(const uint8_t *r) {
+  uint16_t id;
+  memcpy(&id, r, sizeof(id));
+  return id;
+}
+
+static int collate_id_cmp(const void *a, const void *b) {
+  uint16_t x = collate_id((const uint8_t *) a), y = collate_id((const uint8_t *) b);
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int collate_tie_cmp(const void *a, const void *b) {
+  const uint8_t *x = (const uint8_t *) a, *y = (const uint8_t *) b;
+  int c = memcmp(x + 2, y + 2, collate_tie_len);
+  if (c == 0) c = collate_id(x) < collate_id(y) ? -1 : (collate_id(x) > collate_id(y) ? 1 : 0);
+  return c;
+}
+
+// reads the names of a run, puts the window at depth into each record and
+// returns the key bytes all of them have in common; the names are read in
+// id order, for file lists that is dir order, so neighbours share a sector
+static size_t collate_tie_pass(uint8_t *recs, size_t count, size_t rec, size_t depth, collate_name_fn name, void *ctx) {
+  char first[COLLATE_NAME_MAX], cur[COLLATE_NAME_MAX];
+  size_t common = (size_t) -1;
+  qsort(recs, count, rec, collate_id_cmp);
+  for (size_t i = 0; i < count; i++) {
+    uint8_t *r = recs + i * rec;
+    char *n = i == 0 ? first : cur;
+    name(ctx, collate_id(r), n);
+    collate_window(r + 2, rec - 2, n, depth);
+    if (i > 0) {
+      size_t c = collate_common(first, cur);
+      if (c < common) common = c;
+    }
+  }
+  return common;
+}
+
+static void collate_tie_sort(uint8_t *recs, size_t count, size_t rec, size_t depth, uint8_t level, collate_name_fn name, void *ctx) {
+  size_t len = rec - 2;
+  size_t common;
+  while ((common = collate_tie_pass(recs, count, rec, depth, name, ctx)) >= depth + len) {
+    depth = common;
+  }
+  collate_tie_len = len;
+  qsort(recs, count, rec, collate_tie_cmp);
+  if (level + 1 >= COLLATE_TIE_LEVELS) return;
+  for (size_t i = 0, j; i < count; i = j) {
+    const uint8_t *r = recs + i * rec;
+    for (j = i + 1; j < count && memcmp(recs + j * rec + 2, r + 2, len) == 0; j++);
+    if (j - i > 1 && r[rec - 1] != 0) {
+      collate_tie_sort(recs + i * rec, j - i, rec, depth + len, level + 1, name, ctx);
+    }
+  }
+}
+
+void collate_sort_ties(void *recs, size_t count, size_t rec, void *scratch, size_t scratch_size, collate_name_fn name, void *ctx) {
+  uint8_t *base = (uint8_t *) recs;
+  uint8_t *tmp = (uint8_t *) scratch;
+  size_t len = rec - 2;
+  uint8_t key[64];
+  if (len > sizeof(key)) return;
+  for (size_t i = 0, j; i < count; i = j) {
+    uint8_t *r = base + i * rec;
+    for (j = i + 1; j < count && memcmp(base + j * rec + 2, r + 2, len) == 0; j++);
+    size_t n = j - i;
+    // a key that ends in padding holds the whole name
+    if (n < 2 || r[rec - 1] == 0) continue;
+    size_t wide = scratch_size / n;
+    if (wide > 2 + COLLATE_TIE_WINDOW) wide = 2 + COLLATE_TIE_WINDOW;
+    if (wide > rec) {
+      for (size_t k = 0; k < n; k++) memcpy(tmp + k * wide, r + k * rec, 2);
+      collate_tie_sort(tmp, n, wide, len, 0, name, ctx);
+      for (size_t k = 0; k < n; k++) memcpy(r + k * rec, tmp + k * wide, 2);
+    } else {
+      memcpy(key, r + 2, len);
+      collate_tie_sort(r, n, rec, len, 0, name, ctx);
+      for (size_t k = 0; k < n; k++) memcpy(r + k * rec + 2, key, len);
+    }
+  }
+}
+
+size_t collate_prefix_key(uint8_t *key, size_t len, const char *prefix, size_t *at) {
+  size_t n = collate_key(key, len, prefix);
+  size_t plen = strlen(prefix), digits = 0, zeros = 0;
+  while (digits < plen && prefix[plen - digits - 1] >= '0' && prefix[plen - digits - 1] <= '9') digits++;
+  while (zeros + 1 < digits && prefix[plen - digits + zeros] == '0') zeros++;
+  *at = digits > 0 && n < len ? n - (digits - zeros) - 1 : (size_t) -1;
+  return n;
+}
+
+void collate_record_key(uint8_t *key, size_t n, const void *r, size_t rec, collate_name_fn name, void *ctx) {
+  const uint8_t *k = (const uint8_t *) r + 2;
+  size_t len = rec - 2;
+  // a key that ends in padding holds the whole name
+  if (n > len && k[len - 1] != 0) {
+    char s[COLLATE_NAME_MAX];
+    name(ctx, collate_id((const uint8_t *) r), s);
+    collate_key(key, n, s);
+    return;
+  }
+  size_t m = n < len ? n : len;
+  memcpy(key, k, m);
+  if (m < n) memset(key + m, 0, n - m);
+}
+
+size_t collate_lower_bound(const void *recs, size_t count, size_t rec, const uint8_t *key, size_t n, uint8_t *found, collate_name_fn name, void *ctx) {
+  const uint8_t *base = (const uint8_t *) recs;
+  if (n > COLLATE_PREFIX_MAX) n = COLLATE_PREFIX_MAX;
+  size_t len = rec - 2, m = n < len ? n : len;
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (memcmp(base + mid * rec + 2, key, m) < 0) lo = mid + 1; else hi = mid;
+  }
+  size_t known = count; // record whose key is in found already
+  if (n > len) {
+    // the run that ties with the prefix over the whole key, its names decide
+    size_t end = lo;
+    hi = count;
+    while (end < hi) {
+      size_t mid = (end + hi) / 2;
+      if (memcmp(base + mid * rec + 2, key, m) <= 0) end = mid + 1; else hi = mid;
+    }
+    uint8_t k[COLLATE_PREFIX_MAX];
+    hi = end;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      collate_record_key(k, n, base + mid * rec, rec, name, ctx);
+      if (memcmp(k, key, n) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+        known = mid;
+        memcpy(found, k, n);
+      }
+    }
+  }
+  if (lo == count) {
+    memset(found, 0, n);
+  } else if (lo != known) {
+    collate_record_key(found, n, base + lo * rec, rec, name, ctx);
+  }
+  return lo;
+}
+
+// a digit count with no match is not retried one by one: the entry found
+// instead already has the next digit count there is for the prefix
+size_t collate_find(const char *prefix, collate_seek_fn seek, void *ctx) {
+  uint8_t key[COLLATE_PREFIX_MAX], found[COLLATE_PREFIX_MAX];
+  size_t at, first, pos;
+  size_t n = collate_prefix_key(key, sizeof(key), prefix, &at);
+  seek(ctx, key, n, &first, found);
+  if (at == (size_t) -1 || memcmp(found, key, n) == 0) return first;
+  while (memcmp(found, key, at) == 0 && found[at] >= key[at]) {
+    uint8_t next = found[at] == key[at] ? key[at] + 1 : found[at];
+    if (next > '9') break;
+    key[at] = next;
+    seek(ctx, key, n, &pos, found);
+    if (memcmp(found, key, n) == 0) return pos;
+  }
+  // no match, the entry the typed digit count would go before
+  return first;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Compact collation keys for file lists (plain C, also built on the host by
+// tools/sortbench.cpp). Keys compare with memcmp():
+//  - ascii letters are case folded
+//  - a digit run is stored as its digit count ('0' + n, max 9) followed by
+//    the digits without leading zeros, so "a2" < "a10"
+//  - the key is zero padded, a shorter name sorts first
+// collate_key() returns the number of key bytes used, before the padding.
+// collate_cmp() compares two whole names the same way, without a length limit.
+//
+// collate_sort_ties() finishes a list sorted by (key, id) where the key is
+// only a prefix: the runs of records that tie over the whole key are put in
+// the order of their whole names. Each pass over a run reads every name in
+// it once and sorts the run on the next window of key bytes, in scratch when
+// it has room for wider windows, else in the key bytes themselves, which are
+// all the same within the run and are put back afterwards. A pass that
+// leaves the whole run tied skips to where the names first differ, so a long
+// common prefix costs one extra pass rather than one per window. No name is
+// read from inside a comparison.
+//
+// collate_find() looks a typed prefix up in such a list, through a seek
+// callback over the list. collate_lower_bound() is that lookup over records
+// in RAM: it bisects on the key bytes alone down to the run that ties with
+// the prefix over the whole key, and only reads names inside that run.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define COLLATE_NAME_MAX 256 // name buffer size, long name and terminator
+#define COLLATE_TIE_WINDOW 30 // most key bytes per record compared in one pass
+#define COLLATE_TIE_LEVELS 16 // nested passes over a run before the rest stays in id order
+#define COLLATE_PREFIX_MAX 64 // key bytes of a typed prefix
+
+// writes the long name of record id to name, "" when it cannot be read
+typedef void (*collate_name_fn)(void *ctx, uint16_t id, char *name);
+
+// writes the first n key bytes of the entry at or after a collated prefix of
+// n bytes to found (zeros past the end of the list) and its position to pos
+typedef void (*collate_seek_fn)(void *ctx, const uint8_t *key, size_t n, size_t *pos, uint8_t *found);
+
+size_t collate_key(uint8_t *key, size_t len, const char *name);
+int collate_cmp(const char *a, const char *b);
+// key of a typed prefix; at is the digit count byte of a trailing number, or (size_t) -1
+size_t collate_prefix_key(uint8_t *key, size_t len, const char *prefix, size_t *at);
+// records are {u16 id; u8 key[rec - 2]}, key up to 64 bytes
+void collate_sort_ties(void *recs, size_t count, size_t rec, void *scratch, size_t scratch_size, collate_name_fn name, void *ctx);
+// first n key bytes of a record, from its name past the key bytes it holds
+void collate_record_key(uint8_t *key, size_t n, const void *r, size_t rec, collate_name_fn name, void *ctx);
+// first record at or after a collated prefix of n bytes (n up to
+// COLLATE_PREFIX_MAX), its first n key bytes go to found (zeros past the end)
+size_t collate_lower_bound(const void *recs, size_t count, size_t rec, const uint8_t *key, size_t n, uint8_t *found, collate_name_fn name, void *ctx);
+// position of the first entry starting with a typed prefix, else where it
+// would go; a trailing number may still be growing, so its digit count in
+// the key is tried from the typed one up: "200" finds "2000 AD" before "201"
+size_t collate_find(const char *prefix, collate_seek_fn seek, void *ctx);
@@ -148,6 +148,7 @@
 #define CMD_ROMDATA 0x07
 #define CMD_ROMLOADER 0x08
 #define CMD_SPI_CONTROL 0x09
+#define CMD_BURST 0x0A // framed burst: CMD_BURST, cmd, start addr, len-1, payload[len]. equals to len commands (cmd, addr+i, payload[i]), addr wraps at 256
 #define CMD_PS2_SCANCODE 0x0B
 #define CMD_FILEBANK 0x0C
 #define CMD_FILEDATA 0x0D
@@ -198,7 +199,7 @@
 // LED matrix registers
 #define CMD_MATRIX_CTL 0x60 // adr 0, bit 0 - clear, bit1 - update, bit2 - brightness, bit 4-7 - brightness level
 #define CMD_MATRIX_PIXEL 0x61 // adr: xy, data - color (00 - black, 01 - red, 10 - green, 11 - yellow)
-#define CMD_MATRIX_BITPLAN 0x62 // 0...31 - address of byte, 32 bytes total (16 bytes per matrix)
+#define CMD_MATRIX_BITPLAN 0x62 // 0...31 - address of byte, 32 bytes total (16 bytes per matrix: 8 red rows, 8 green rows), shown after byte 31
 #define CMD_MATRIX_BTN 0x63 // bits 0-3 represents keypresses for shield buttons
 
 // Audio data (slow peaks)
@@ -253,10 +254,36 @@
 #define FILE_POS_FILELOADER_FILE 121
 #define FILE_POS_FILELOADER_EXTENSIONS 153
 #define FILE_POS_SPI_FREQ 185
+#define FILE_POS_COMPRESSION 186
+#define FILE_POS_CORE_FEATURES 187
 #define FILE_POS_EEPROM_DATA 256
 #define FILE_POS_SWITCHES_DATA 512
 #define FILE_POS_BITSTREAM_START 1024
 
+// FILE_POS_CORE_FEATURES bits
+#define CORE_FEATURE_BURST 0 // core understands CMD_BURST frames
+#define CORE_FEATURE_OSD_STREAM 1 // osd has the cursor attribute and char stream registers
+
+// FILE_POS_COMPRESSION flags, packed sections store compressed lengths (see tools/kgpack.py)
+#define COMPRESSION_BITSTREAM 0x01
+#define COMPRESSION_ROMS 0x02
+
+#define CONF_CCLK_FREQ 30000000 // slave serial CCLK, limited by the SD read speed anyway
+#define CONF_BUF_SIZE 4096 // bitstream loader double buffer size (x2)
+
+#define SPI_STREAM_BUFS 4 // sd -> fpga stream ring, buffers
+#define SPI_STREAM_BUF_SIZE 512 // sd -> fpga stream ring, bytes per buffer (one sector)
+
+#define SPI_EVENTS_USB_SIZE 1024 // usb host (core1) -> main loop event ring, entries, power of 2
+#define SPI_EVENTS_IRQ_SIZE 256 // ps/2 repeat alarm (core0 irq) -> main loop event ring, entries, power of 2
+#define SPI_EVENTS_WAIT_US 5000 // max time the usb core waits for a free slot before dropping
+#define SPI_EVENTS_BATCH 32 // events drained per batch
+
+#define SCHED_BUDGET_US 2000 // main loop pass budget, cosmetic tasks are deferred past it
+#define SCHED_MAX_DEFER_US 200000 // cosmetic tasks run anyway after being deferred this long
+
+#define FT_ASSETS_VERSION 1 // FT812 GRAM asset version (bitmaps.h), bump to force a re-upload of resident assets
+
 #if HW_ID==HW_ID_GO
 #define FILENAME_BOOT "boot.kg1"
 #define FILENAME_FBOOT "/boot.kg1"
@@ -273,9 +300,22 @@
 
 #define APP_COREBROWSER_MENU_OFFSET 5
 
-#define SORT_HASH_LEN 4
+#define SORT_KEY_LEN 4 // collation key prefix per file list entry (see collate.h), 6 bytes per entry with the id
+#define SORT_REC_KEY_LEN 62 // collation key bytes per record while a list is sorted, ties past it compare the long names
 #define SORT_FILES_MAX 8000
 
+#define FILE_INDEX_DIR "/.kgcache" // sorted file list caches, see file_index.cpp
+#define FILE_INDEX_VERSION 4
+#define FILE_INDEX_TMP "/.kgcache/sort.tmp" // sorted runs of lists over SORT_FILES_MAX
+#define FILE_INDEX_TMP2 "/.kgcache/sort2.tmp" // merge passes over more than EXT_SORT_FAN_IN runs
+#define FILE_INDEX_SAMPLES 1024 // key samples of a paged list kept in files[], a search reads one block of at most 64 records
+#define FILE_INDEX_LOAD_CHUNK 128 // records per read of an index loaded in slices
+#define FILE_SCAN_SLICE_US 2000 // progressive dir scan time per main loop pass, see app_file_loader_on_scan()
+#define FILE_SCAN_DRAW_MS 250 // file list redraw interval while scanning
+
+#define TYPEAHEAD_LEN 16 // type-ahead search prefix chars, see typeahead.h
+#define TYPEAHEAD_TIMEOUT 1000 // ms without a key to start a new prefix
+
 #ifndef WAIT_SERIAL
 #define WAIT_SERIAL 0
 #endif
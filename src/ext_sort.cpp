@@ -0,0 +1,121 @@
+#include <string.h>
+#include "ext_sort.h"
+
+void ext_sort_begin(ext_sort_t *s, void *buf, uint32_t buf_size, uint16_t rec, ext_sort_cmp cmp, ext_sort_file_t *tmp, ext_sort_file_t *tmp2) {
+  s->buf = (uint8_t *) buf;
+  s->buf_size = buf_size;
+  s->rec = rec;
+  s->cmp = cmp;
+  s->tmp[0] = tmp;
+  s->tmp[1] = tmp2;
+  s->run_len = buf_size / rec;
+  s->total = 0;
+  s->done = false;
+}
+
+// appends the first count (sorted) records of the buffer as a new run,
+// all runs but the last are full, so they are found by position alone
+bool ext_sort_spill(ext_sort_t *s, uint32_t count) {
+  if (count == 0) return true;
+  if (count > s->run_len || s->total % s->run_len != 0) return false;
+  if (!s->tmp[0]->write(s->tmp[0]->ctx, s->total * s->rec, s->buf, count * s->rec)) return false;
+  s->total += count;
+  return true;
+}
+
+uint32_t ext_sort_runs(const ext_sort_t *s) {
+  return (s->total + s->run_len - 1) / s->run_len;
+}
+
+// the buffer is split into one segment per run head plus one for the output
+static bool ext_sort_group(ext_sort_t *s) {
+  uint32_t runs = (s->total + s->pass_len - 1) / s->pass_len;
+  s->k = runs - s->group < EXT_SORT_FAN_IN ? runs - s->group : EXT_SORT_FAN_IN;
+  s->seg = s->buf_size / (s->k + 1) / s->rec;
+  for (uint8_t i=0; i<s->k; i++) {
+    uint32_t start = (s->group + i) * s->pass_len;
+    s->next[i] = start;
+    s->left[i] = s->total - start < s->pass_len ? s->total - start : s->pass_len;
+    s->head[i] = s->fill[i] = 0;
+  }
+  return s->seg > 0;
+}
+
+static bool ext_sort_pass(ext_sort_t *s) {
+  s->last = (s->total + s->pass_len - 1) / s->pass_len <= EXT_SORT_FAN_IN;
+  s->group = 0;
+  s->pos = s->last ? s->out_pos : 0;
+  s->merged = 0;
+  return ext_sort_group(s);
+}
+
+bool ext_sort_merge_begin(ext_sort_t *s, ext_sort_file_t *out, uint32_t pos, uint16_t out_rec) {
+  s->out = out;
+  s->out_pos = pos;
+  s->out_rec = out_rec;
+  s->src = 0;
+  s->pass_len = s->run_len;
+  s->done = s->total == 0;
+  return s->done || ext_sort_pass(s);
+}
+
+// writes the next output segment, s->done is set once the list is in out
+bool ext_sort_merge_step(ext_sort_t *s) {
+  if (s->done) return true;
+  uint16_t rec = s->rec;
+  uint16_t orec = s->last ? s->out_rec : rec;
+  uint8_t *obuf = s->buf + s->k * s->seg * rec;
+  uint32_t ofill = 0;
+  int8_t best;
+  do {
+    // k is small, a linear pick of the smallest head is enough; ties go to the earlier run
+    best = -1;
+    const uint8_t *best_rec = nullptr;
+    for (uint8_t i=0; i<s->k; i++) {
+      if (s->head[i] == s->fill[i]) {
+        if (s->left[i] == 0) continue;
+        uint32_t n = s->left[i] < s->seg ? s->left[i] : s->seg;
+        ext_sort_file_t *src = s->tmp[s->src];
+        if (!src->read(src->ctx, s->next[i] * rec, s->buf + i * s->seg * rec, n * rec)) return false;
+        s->next[i] += n;
+        s->left[i] -= n;
+        s->fill[i] = n;
+        s->head[i] = 0;
+      }
+      const uint8_t *r = s->buf + (i * s->seg + s->head[i]) * rec;
+      if (best < 0 || s->cmp(r, best_rec) < 0) {
+        best = i;
+        best_rec = r;
+      }
+    }
+    if (best < 0) break;
+    memcpy(obuf + ofill * orec, best_rec, orec);
+    s->head[best]++;
+  } while (++ofill < s->seg);
+
+  ext_sort_file_t *dst = s->last ? s->out : s->tmp[s->src ^ 1];
+  if (ofill > 0 && !dst->write(dst->ctx, s->pos, obuf, ofill * orec)) return false;
+  s->pos += ofill * orec;
+  s->merged += ofill;
+  if (best >= 0) return true;
+
+  // group done, then the pass, the merged runs are the input of the next one
+  s->group += s->k;
+  if (s->group * s->pass_len < s->total) return ext_sort_group(s);
+  if (s->last) {
+    s->done = true;
+    return true;
+  }
+  s->src ^= 1;
+  s->pass_len *= EXT_SORT_FAN_IN;
+  return ext_sort_pass(s);
+}
+
+// the whole merge in one go
+bool ext_sort_merge(ext_sort_t *s, ext_sort_file_t *out, uint32_t pos, uint16_t out_rec) {
+  if (!ext_sort_merge_begin(s, out, pos, out_rec)) return false;
+  while (!s->done) {
+    if (!ext_sort_merge_step(s)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// External merge sort for lists that do not fit in RAM (plain C, also built
+// on the host by tools/extsort_check.cpp).
+//
+// The caller fills its buffer, sorts it and spills it as a run to a temp
+// file with ext_sort_spill(), then the runs are k-way merged into the output
+// file, reusing the same buffer for the run heads and the output, so no
+// memory is needed beyond the one buffer. More than EXT_SORT_FAN_IN runs
+// take extra passes through a second temp file. The merge goes one output
+// segment per ext_sort_merge_step(), so it can be spread over main loop passes.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EXT_SORT_FAN_IN 16 // runs merged at once
+
+// positional file access, true when all len bytes were transferred
+typedef struct {
+  void *ctx;
+  bool (*read)(void *ctx, uint32_t pos, void *buf, uint32_t len);
+  bool (*write)(void *ctx, uint32_t pos, const void *buf, uint32_t len);
+} ext_sort_file_t;
+
+typedef int (*ext_sort_cmp)(const void *a, const void *b);
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t buf_size; // bytes
+  uint16_t rec; // record size
+  ext_sort_cmp cmp;
+  ext_sort_file_t *tmp[2]; // runs, and the longer runs of the next merge pass
+  uint32_t run_len; // records per spilled run, only the last one may be shorter
+  uint32_t total; // records in all runs
+
+  // merge state
+  bool done;
+  ext_sort_file_t *out;
+  uint32_t out_pos; // output file position of the merged list
+  uint16_t out_rec; // leading bytes of each record written to out
+  uint8_t src; // tmp file with the runs of this pass
+  bool last; // this pass writes to out
+  uint32_t pass_len; // records per run in this pass
+  uint32_t group; // first run of the group being merged
+  uint32_t pos; // output position of the next segment
+  uint32_t merged; // records written in this pass
+  uint8_t k; // runs in the group
+  uint32_t seg; // records per buffer segment
+  uint32_t next[EXT_SORT_FAN_IN]; // next record of the run in tmp
+  uint32_t left[EXT_SORT_FAN_IN]; // records of the run still in tmp
+  uint32_t head[EXT_SORT_FAN_IN]; // current record in the run segment
+  uint32_t fill[EXT_SORT_FAN_IN]; // records in the run segment
+} ext_sort_t;
+
+void ext_sort_begin(ext_sort_t *s, void *buf, uint32_t buf_size, uint16_t rec, ext_sort_cmp cmp, ext_sort_file_t *tmp, ext_sort_file_t *tmp2);
+bool ext_sort_spill(ext_sort_t *s, uint32_t count);
+uint32_t ext_sort_runs(const ext_sort_t *s);
+bool ext_sort_merge_begin(ext_sort_t *s, ext_sort_file_t *out, uint32_t pos, uint16_t out_rec);
+bool ext_sort_merge_step(ext_sort_t *s);
+bool ext_sort_merge(ext_sort_t *s, ext_sort_file_t *out, uint32_t pos, uint16_t out_rec);
@@ -2,6 +2,7 @@
 #include "config.h"
 #include "types.h"
 #include "file.h"
+#include <Lzss.h>
 #include "main.h"
 
 void file_seek(uint32_t pos) {
@@ -62,3 +63,61 @@ void file_write16(uint32_t pos, uint16_t val) {
   file_seek(pos+1);
   file1.write((uint8_t) val);
 }
+
+// sequential reader of a (possibly lzss packed) container section,
+// starting at the current file1 position
+static Lzss section_lzss;
+static uint8_t section_buf[512];
+static size_t section_buf_len = 0;
+static size_t section_buf_pos = 0;
+static uint32_t section_len = 0;
+static uint32_t section_left = 0;
+static bool section_packed = false;
+
+void file_section_begin(uint32_t len, bool packed) {
+  section_len = len;
+  section_left = len;
+  section_packed = packed;
+  section_buf_len = 0;
+  section_buf_pos = 0;
+  if (packed) section_lzss.reset();
+}
+
+// returns unpacked bytes, 0 at the end of section
+int file_section_read(uint8_t *buf, size_t len) {
+  if (!section_packed) {
+    if (len > section_left) len = section_left;
+    if (len == 0) return 0;
+    int n = file1.read(buf, len);
+    if (n <= 0) { section_left = 0; return 0; }
+    section_left -= n;
+    return n;
+  }
+
+  size_t out = 0;
+  while (out < len) {
+    if (section_buf_pos == section_buf_len && section_left > 0) {
+      int n = file1.read(section_buf, (section_left < sizeof(section_buf)) ? section_left : sizeof(section_buf));
+      if (n <= 0) { section_left = 0; n = 0; }
+      section_left -= n;
+      section_buf_len = n;
+      section_buf_pos = 0;
+    }
+    size_t used = 0;
+    size_t n = section_lzss.decode(section_buf + section_buf_pos, section_buf_len - section_buf_pos, &used, buf + out, len - out);
+    section_buf_pos += used;
+    out += n;
+    if (n == 0 && used == 0) {
+      if (section_left == 0 && !section_lzss.idle()) {
+        d_println("Packed section is truncated");
+      }
+      break;
+    }
+  }
+  return out;
+}
+
+// stored (packed) bytes consumed so far, for progress indication
+uint32_t file_section_pos() {
+  return section_len - section_left - (section_buf_len - section_buf_pos);
+}
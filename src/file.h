@@ -15,3 +15,7 @@ uint32_t file_read24(uint32_t pos);
 uint32_t file_read32(uint32_t pos);
 void file_get_name(char *buf, size_t len);
 void file_write16(uint32_t pos, uint16_t val);
+
+void file_section_begin(uint32_t len, bool packed);
+int file_section_read(uint8_t *buf, size_t len);
+uint32_t file_section_pos();
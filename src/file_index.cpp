@@ -0,0 +1,365 @@
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "main.h"
+#include "SdFat.h"
+#include "file_index.h"
+#include "strutil.h"
+#include "sorts.h"
+#include "ext_sort.h"
+#include "collate.h"
+
+// Index file layout, little endian:
+//   "KGIX", u8 version, u8 key_len, u16 count,
+//   u32 entries, u32 fingerprint, u32 ext_hash, u32 crc (mem_hash of the records),
+//   count x {u16 file_id, u8 key[key_len]} in display order, that is by the
+//   whole collated long name, of which key holds the first key_len bytes (see collate.h).
+//
+// The fingerprint covers name, attributes, first cluster, size and mtime of
+// every short directory entry and the long name entries as a whole, read raw
+// without opening the files, so any add / delete / rename / rewrite in the
+// directory invalidates the index.
+//
+// Lists longer than the items buffer are scanned as sort records, sorted in
+// runs spilled to FILE_INDEX_TMP and merged into the index file a segment at
+// a time (see ext_sort.h); shorter ones are sorted in the items buffer and
+// saved with file_index_save(). Lists longer than the items buffer are paged: the
+// file loader reads them with file_index_read() on the open index file, and
+// a key sample of every step-th record stays at the start of the items
+// buffer, so a search reads a single block. An index is loaded a step at a
+// time and checked against the dir afterwards, so the list is drawn and
+// usable from the first step on.
+
+#define FILE_INDEX_MAGIC "KGIX"
+#define FILE_INDEX_STEP_ENTRIES 16 // raw dir entries per fingerprint step, a sector
+
+typedef struct __attribute__((packed)) {
+  char magic[4];
+  uint8_t version;
+  uint8_t key_len;
+  uint16_t count;
+  uint32_t entries;
+  uint32_t fingerprint;
+  uint32_t ext_hash;
+  uint32_t crc;
+} file_index_header_t;
+
+static_assert(sizeof(file_list_sort_item_t) == 2 + SORT_KEY_LEN, "index records are stored as is");
+static_assert(offsetof(file_sort_rec_t, key) == offsetof(file_list_sort_item_t, key) && SORT_REC_KEY_LEN >= SORT_KEY_LEN, "list entries are the head of the sort records");
+
+void file_index_open(file_index_t *idx, const char *dir_path, const char *exts) {
+  file_index_close(idx);
+  uint32_t key = mem_hash(dir_path, strlen(dir_path));
+  key = mem_hash("|", 1, key);
+  key = mem_hash(exts, strlen(exts), key);
+  snprintf(idx->path, sizeof(idx->path), "%s/%08lx.idx", FILE_INDEX_DIR, (unsigned long) key);
+  idx->ext_hash = mem_hash(exts, strlen(exts));
+
+  // created up front, so it does not change the fingerprint of the root dir later
+  if (!sd1.exists(FILE_INDEX_DIR)) sd1.mkdir(FILE_INDEX_DIR);
+  idx->entries = 0;
+  idx->fingerprint = 0;
+}
+
+// a full pass over the raw dir entries before a save, a load takes it in
+// steps while the list is in use already (see file_index_current());
+// readDir() skips the long name entries, so they are read as is
+void file_index_fingerprint(file_index_t *idx, File32 *dir) {
+  file_index_fingerprint_begin(idx, dir);
+  while (!file_index_fingerprint_step(idx, dir));
+}
+
+void file_index_fingerprint_begin(file_index_t *idx, File32 *dir) {
+  dir->rewind();
+  idx->dir_pos = dir->curPosition();
+  idx->entries = 0;
+  idx->fingerprint = MEM_HASH_SEED;
+}
+
+// hashes the next sector of dir entries, true once the whole dir is in;
+// the dir is used in between steps, so its position is kept here
+bool file_index_fingerprint_step(file_index_t *idx, File32 *dir) {
+  uint32_t h = idx->fingerprint;
+  DirFat_t d;
+  bool more = dir->seekSet(idx->dir_pos);
+  for (uint8_t i = 0; more && i < FILE_INDEX_STEP_ENTRIES; i++) {
+    more = dir->read(&d, sizeof(d)) == sizeof(d) && d.name[0] != FAT_NAME_FREE;
+    if (!more || d.name[0] == FAT_NAME_DELETED) continue;
+    if (d.attributes == FAT_ATTRIB_LONG_NAME) {
+      h = mem_hash(&d, sizeof(d), h);
+      continue;
+    }
+    h = mem_hash(d.name, sizeof(d.name), h);
+    h = mem_hash(&d.attributes, sizeof(d.attributes), h);
+    h = mem_hash(d.firstClusterHigh, sizeof(d.firstClusterHigh), h);
+    h = mem_hash(d.modifyTime, sizeof(d.modifyTime), h);
+    h = mem_hash(d.modifyDate, sizeof(d.modifyDate), h);
+    h = mem_hash(d.firstClusterLow, sizeof(d.firstClusterLow), h);
+    h = mem_hash(d.fileSize, sizeof(d.fileSize), h);
+    idx->entries++;
+  }
+  idx->fingerprint = h;
+  idx->dir_pos = dir->curPosition();
+  if (!more) dir->rewind();
+  return !more;
+}
+
+void file_index_close(file_index_t *idx) {
+  if (idx->file.isOpen()) idx->file.close();
+}
+
+bool file_index_load(file_index_t *idx, file_list_sort_item_t *items, uint16_t max, uint16_t *count) {
+  bool ok = file_index_load_begin(idx, max);
+  if (ok && !file_index_current(idx)) {
+    file_index_close(idx);
+    ok = false;
+  }
+  while (ok && idx->loaded < idx->count) {
+    ok = file_index_load_step(idx, items, max);
+  }
+  if (ok) *count = idx->count;
+  return ok;
+}
+
+static file_index_header_t file_index_hdr; // of the index being loaded
+
+// opens the index and checks its header, bar the fingerprint of the dir,
+// which may be taken after: see file_index_current()
+bool file_index_load_begin(file_index_t *idx, uint16_t max) {
+  file_index_close(idx);
+  File32 *f = &idx->file;
+  if (!f->open(&sd1, idx->path, O_RDONLY)) return false;
+
+  file_index_header_t *hdr = &file_index_hdr;
+  bool ok = f->read(hdr, sizeof(*hdr)) == sizeof(*hdr)
+    && memcmp(hdr->magic, FILE_INDEX_MAGIC, sizeof(hdr->magic)) == 0
+    && hdr->version == FILE_INDEX_VERSION
+    && hdr->key_len == SORT_KEY_LEN
+    && hdr->ext_hash == idx->ext_hash;
+  if (!ok) {
+    f->close();
+    return false;
+  }
+  // a list longer than max is paged, the items buffer starts with its key samples then
+  idx->count = hdr->count;
+  idx->loaded = 0;
+  idx->crc = MEM_HASH_SEED;
+  idx->step = hdr->count > max ? (hdr->count + FILE_INDEX_SAMPLES - 1) / FILE_INDEX_SAMPLES : 1;
+  // an empty list has no step to check it
+  if (hdr->count == 0) {
+    f->close();
+    return hdr->crc == idx->crc;
+  }
+  return true;
+}
+
+// reads the next records into the items buffer, or their key samples when
+// paged, and checks the crc after the last; false when that fails, the index
+// is closed then. The file is used in between steps, so each one seeks.
+bool file_index_load_step(file_index_t *idx, file_list_sort_item_t *items, uint16_t max) {
+  File32 *f = &idx->file;
+  bool paged = idx->count > max;
+  file_list_sort_item_t chunk[FILE_INDEX_LOAD_CHUNK];
+  file_list_sort_item_t *buf = paged ? chunk : items + idx->loaded;
+  uint16_t n = idx->count - idx->loaded < FILE_INDEX_LOAD_CHUNK ? idx->count - idx->loaded : FILE_INDEX_LOAD_CHUNK;
+  size_t len = n * sizeof(file_list_sort_item_t);
+  bool ok = f->seekSet(sizeof(file_index_header_t) + (uint32_t) idx->loaded * sizeof(file_list_sort_item_t))
+    && f->read(buf, len) == (int) len;
+  if (ok) {
+    idx->crc = mem_hash(buf, len, idx->crc);
+    if (paged) {
+      uint32_t from = idx->loaded;
+      for (uint32_t i = (from + idx->step - 1) / idx->step * idx->step; i < from + n; i += idx->step) {
+        items[i / idx->step] = chunk[i - from];
+      }
+    }
+    idx->loaded += n;
+    ok = idx->loaded < idx->count || idx->crc == file_index_hdr.crc;
+  }
+  if (!ok || (!paged && idx->loaded == idx->count)) f->close();
+  return ok;
+}
+
+// the index loaded was made from the dir as it is, by the fingerprint taken last
+bool file_index_current(const file_index_t *idx) {
+  return file_index_hdr.entries == idx->entries && file_index_hdr.fingerprint == idx->fingerprint;
+}
+
+// count records from list position from, the index is open after a paged file_index_load()
+bool file_index_read(file_index_t *idx, uint16_t from, file_list_sort_item_t *items, uint16_t count) {
+  size_t len = count * sizeof(file_list_sort_item_t);
+  return idx->file.isOpen()
+    && idx->file.seekSet(sizeof(file_index_header_t) + (uint32_t) from * sizeof(file_list_sort_item_t))
+    && idx->file.read(items, len) == (int) len;
+}
+
+static void file_index_header(file_index_header_t *hdr, const file_index_t *idx, uint16_t count, uint32_t crc) {
+  memcpy(hdr->magic, FILE_INDEX_MAGIC, sizeof(hdr->magic));
+  hdr->version = FILE_INDEX_VERSION;
+  hdr->key_len = SORT_KEY_LEN;
+  hdr->count = count;
+  hdr->entries = idx->entries;
+  hdr->fingerprint = idx->fingerprint;
+  hdr->ext_hash = idx->ext_hash;
+  hdr->crc = crc;
+}
+
+bool file_index_save(const file_index_t *idx, const file_list_sort_item_t *items, uint16_t count) {
+  File32 f;
+  if (!f.open(&sd1, idx->path, O_WRONLY | O_CREAT | O_TRUNC)) return false;
+
+  size_t len = count * sizeof(file_list_sort_item_t);
+  file_index_header_t hdr;
+  file_index_header(&hdr, idx, count, mem_hash(items, len));
+
+  bool ok = f.write(&hdr, sizeof(hdr)) == sizeof(hdr) && f.write(items, len) == len;
+  ok = f.close() && ok;
+  if (!ok) sd1.remove(idx->path);
+  return ok;
+}
+
+// Lists are sorted by key and dir index, then the entries that tie over
+// the whole key are put in the order of their long names, each read a
+// few times at most rather than once per comparison (see collate.h).
+// Runs of long lists are sorted as file_sort_rec_t records with
+// SORT_REC_KEY_LEN key bytes the same way, and only the list entry part of
+// each (id and key prefix) goes into the index.
+
+static File32 *file_index_dir; // dir of the list being sorted
+
+void file_index_name(void *ctx, uint16_t id, char *name) {
+  File32 f;
+  name[0] = '\0';
+  if (f.open((File32 *) ctx, id, O_RDONLY)) {
+    f.getName(name, COLLATE_NAME_MAX);
+    f.close();
+  }
+}
+
+// the dir position is kept for a scan going on in between
+static void file_index_ties(File32 *dir, void *recs, uint16_t count, size_t rec, void *scratch, size_t scratch_size) {
+  uint32_t pos = dir->curPosition();
+  collate_sort_ties(recs, count, rec, scratch, scratch_size, file_index_name, dir);
+  dir->seekSet(pos);
+}
+
+static bool file_index_rec_less(const file_sort_rec_t &a, const file_sort_rec_t &b) {
+  int c = memcmp(a.key, b.key, SORT_REC_KEY_LEN);
+  return c < 0 || (c == 0 && a.file_id < b.file_id);
+}
+
+// the run heads of a merge still read the long names when they tie over
+// the whole key, within a run such records are in name order already
+static int file_index_cmp(const void *a, const void *b) {
+  const file_sort_rec_t *x = (const file_sort_rec_t *) a;
+  const file_sort_rec_t *y = (const file_sort_rec_t *) b;
+  int c = memcmp(x->key, y->key, SORT_REC_KEY_LEN);
+  // a padded key holds the whole name, otherwise the names may differ past it
+  if (c == 0 && x->key[SORT_REC_KEY_LEN-1] != 0) {
+    char na[COLLATE_NAME_MAX], nb[COLLATE_NAME_MAX];
+    file_index_name(file_index_dir, x->file_id, na);
+    file_index_name(file_index_dir, y->file_id, nb);
+    c = collate_cmp(na, nb);
+  }
+  if (c == 0) c = x->file_id < y->file_id ? -1 : (x->file_id > y->file_id ? 1 : 0);
+  return c;
+}
+
+// list entries sorted by key and id get the ties over the key put in name
+// order; scratch, the unused rest of the list buffer, makes that take fewer passes
+void file_index_sort_ties(File32 *dir, file_list_sort_item_t *items, uint16_t count, void *scratch, size_t scratch_size) {
+  file_index_ties(dir, items, count, sizeof(file_list_sort_item_t), scratch, scratch_size);
+}
+
+// external sort of long lists, the temp runs files and the merged index
+// are accessed through the ext_sort_file_t callbacks
+
+static File32 file_index_tmp;
+static File32 file_index_tmp2;
+static File32 file_index_out;
+static uint32_t file_index_crc; // records reach the index file in order, so the crc is taken on the way
+
+static bool file_index_io_read(void *ctx, uint32_t pos, void *buf, uint32_t len) {
+  File32 *f = (File32 *) ctx;
+  return f->seekSet(pos) && f->read(buf, len) == (int) len;
+}
+
+static bool file_index_io_write(void *ctx, uint32_t pos, const void *buf, uint32_t len) {
+  File32 *f = (File32 *) ctx;
+  return f->seekSet(pos) && f->write(buf, len) == len;
+}
+
+static bool file_index_io_write_crc(void *ctx, uint32_t pos, const void *buf, uint32_t len) {
+  file_index_crc = mem_hash(buf, len, file_index_crc);
+  return file_index_io_write(ctx, pos, buf, len);
+}
+
+static ext_sort_file_t file_index_tmp_io = {&file_index_tmp, file_index_io_read, file_index_io_write};
+static ext_sort_file_t file_index_tmp2_io = {&file_index_tmp2, file_index_io_read, file_index_io_write};
+static ext_sort_file_t file_index_out_io = {&file_index_out, file_index_io_read, file_index_io_write_crc};
+
+static void file_index_sort_end() {
+  if (file_index_tmp.isOpen()) file_index_tmp.close();
+  if (file_index_tmp2.isOpen()) file_index_tmp2.close();
+  sd1.remove(FILE_INDEX_TMP);
+  sd1.remove(FILE_INDEX_TMP2);
+}
+
+void file_index_sort_begin(ext_sort_t *sort, File32 *dir, file_sort_rec_t *recs, uint16_t max) {
+  if (file_index_out.isOpen()) file_index_out.close();
+  if (file_index_tmp.isOpen()) file_index_tmp.close();
+  if (file_index_tmp2.isOpen()) file_index_tmp2.close();
+  file_index_dir = dir;
+  ext_sort_begin(sort, recs, max * sizeof(file_sort_rec_t), sizeof(file_sort_rec_t), file_index_cmp, &file_index_tmp_io, &file_index_tmp2_io);
+}
+
+// sorts the first count records of the buffer and spills them as a run
+bool file_index_sort_spill(ext_sort_t *sort, uint16_t count) {
+  if (!file_index_tmp.isOpen() && !file_index_tmp.open(&sd1, FILE_INDEX_TMP, O_RDWR | O_CREAT | O_TRUNC)) return false;
+  file_sort_rec_t *recs = (file_sort_rec_t *) sort->buf;
+  std::sort(recs, recs + count, file_index_rec_less);
+  file_index_ties(file_index_dir, recs, count, sizeof(file_sort_rec_t), nullptr, 0);
+  return ext_sort_spill(sort, count);
+}
+
+// starts merging the runs into the index file, the items buffer belongs to
+// the merge until file_index_sort_step() has set sort->done or failed
+bool file_index_sort_merge(const file_index_t *idx, ext_sort_t *sort) {
+  bool ok = sort->total <= 0xFFFF
+    && (ext_sort_runs(sort) <= EXT_SORT_FAN_IN || file_index_tmp2.open(&sd1, FILE_INDEX_TMP2, O_RDWR | O_CREAT | O_TRUNC))
+    && file_index_out.open(&sd1, idx->path, O_RDWR | O_CREAT | O_TRUNC);
+  if (ok) {
+    file_index_crc = MEM_HASH_SEED;
+    ok = ext_sort_merge_begin(sort, &file_index_out_io, sizeof(file_index_header_t), sizeof(file_list_sort_item_t));
+  }
+  if (!ok) file_index_sort_abort(idx);
+  return ok;
+}
+
+// merges the next output segment, the header goes last, once the records
+// are all in; the temp files are removed when done or failed
+bool file_index_sort_step(const file_index_t *idx, ext_sort_t *sort) {
+  bool ok = ext_sort_merge_step(sort);
+  if (ok && !sort->done) return true;
+  if (ok) {
+    file_index_header_t hdr;
+    file_index_header(&hdr, idx, sort->total, file_index_crc);
+    ok = file_index_out.seekSet(0) && file_index_out.write(&hdr, sizeof(hdr)) == sizeof(hdr);
+    ok = file_index_out.close() && ok;
+  }
+  if (!ok) {
+    file_index_sort_abort(idx);
+    return false;
+  }
+  file_index_sort_end();
+  return true;
+}
+
+// drops a scan or merge in progress along with its partial index
+void file_index_sort_abort(const file_index_t *idx) {
+  if (file_index_out.isOpen()) {
+    file_index_out.close();
+    sd1.remove(idx->path);
+  }
+  file_index_sort_end();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "SdFat.h"
+#include "ext_sort.h"
+
+// Sorted file list cache, one sidecar file per directory and extension
+// filter in FILE_INDEX_DIR (see tools/kgindex.py for the format).
+
+typedef struct {
+  char path[32]; // index file path
+  uint32_t entries; // short directory entries (files and dirs)
+  uint32_t fingerprint; // hash of the raw directory entries, long names included
+  uint32_t ext_hash; // hash of the extension filter
+  File32 file; // stays open while a long list is paged from it
+  uint16_t step; // records per key sample of a paged list
+  uint16_t count; // records in the index file being loaded
+  uint16_t loaded; // records of it read and checked so far
+  uint32_t crc; // mem_hash of the records read so far
+  uint32_t dir_pos; // next raw dir entry of a fingerprint taken in steps
+} file_index_t;
+
+void file_index_open(file_index_t *idx, const char *dir_path, const char *exts);
+void file_index_close(file_index_t *idx);
+void file_index_fingerprint(file_index_t *idx, File32 *dir);
+void file_index_fingerprint_begin(file_index_t *idx, File32 *dir);
+bool file_index_fingerprint_step(file_index_t *idx, File32 *dir);
+bool file_index_load(file_index_t *idx, file_list_sort_item_t *items, uint16_t max, uint16_t *count);
+bool file_index_load_begin(file_index_t *idx, uint16_t max);
+bool file_index_load_step(file_index_t *idx, file_list_sort_item_t *items, uint16_t max);
+bool file_index_current(const file_index_t *idx);
+bool file_index_read(file_index_t *idx, uint16_t from, file_list_sort_item_t *items, uint16_t count);
+bool file_index_save(const file_index_t *idx, const file_list_sort_item_t *items, uint16_t count);
+
+// collate_name_fn over the entries of the dir ctx
+void file_index_name(void *ctx, uint16_t id, char *name);
+void file_index_sort_ties(File32 *dir, file_list_sort_item_t *items, uint16_t count, void *scratch, size_t scratch_size);
+
+void file_index_sort_begin(ext_sort_t *sort, File32 *dir, file_sort_rec_t *recs, uint16_t max);
+bool file_index_sort_spill(ext_sort_t *sort, uint16_t count);
+bool file_index_sort_merge(const file_index_t *idx, ext_sort_t *sort);
+bool file_index_sort_step(const file_index_t *idx, ext_sort_t *sort);
+void file_index_sort_abort(const file_index_t *idx);
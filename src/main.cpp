@@ -46,6 +46,11 @@
 #include "app_about.h"
 #include "app_core.h"
 #include "file.h"
+#include "profiler.h"
+#include "spi_stream.h"
+#include "spi_events.h"
+#include "scheduler.h"
+#include "strutil.h"
 #include <IniFile.h>
 #include "hid_driver.h"
 #include "tusb.h"
@@ -57,8 +62,9 @@
 #include <Adafruit_GFX.h>
 #include "Adafruit_LEDBackpack.h"
 #define SSD1306_NO_SPLASH
-#include "Adafruit_SSD1306.h"
+#include "SSD1306Async.h"
 #include "MultiMatrixDisplay.h"
+#include <FpgaLoader.h>
 
 PioSPI spiSD(PIN_SD_SPI_TX, PIN_SD_SPI_RX, PIN_SD_SPI_SCK, SD_CS_PIN, SPI_MODE0, SD_SCK_MHZ(16)); // dedicated SD1 SPI
 #define SD_CONFIG  SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(16), &spiSD) // SD1 SPI Settings
@@ -77,8 +83,12 @@ OSD zxosd;
 EspSerial esp_serial;
 ESP8266 wifi(esp_serial);
 MultiMatrixDisplay matrix = MultiMatrixDisplay();
+FpgaLoader fpga_loader;
+static uint8_t conf_buf[2][CONF_BUF_SIZE] __attribute__((aligned(4)));
 
 file_list_sort_item_t files[SORT_FILES_MAX];
+// the size of the list of 4 char short name hashes it replaced, longer keys cost list length
+static_assert(sizeof(files) <= 48000, "files[] is over its RAM budget");
 uint16_t files_len = 0;
 uint16_t file_sel = 0;
 uint16_t file_page_size = MAX_CORES_PER_PAGE;
@@ -96,9 +106,6 @@ FT812 ft(PIN_MCU_FT_CS);
 FT812 ft(PIN_MCU_FT_CS, PIN_FT_RESET);
 #endif
 
-static queue_t spi_event_queue;
-volatile bool queue_locked = false;
-
 hid_keyboard_report_t usb_keyboard_report;
 hid_mouse_report_t usb_mouse_report;
 
@@ -149,14 +156,14 @@ bool prev_kb_repeat_state = false;
 
 setup_t hw_setup;
 
-const String matrix_msg = "KARABAS GO ";
-const int matrix_msg_width = matrix_msg.length() * 6; // 6 pixels per character width
+const char matrix_msg[] = "KARABAS GO ";
+const int matrix_msg_width = (sizeof(matrix_msg) - 1) * 6; // 6 pixels per character width
 int matrix_msg_scrollpos = 16;
-ElapsedTimer matrix_timer, matrix_scroll_timer, matrix_poll_timer, oled_timer;
+ElapsedTimer matrix_scroll_timer;
 uint8_t matrix_mode = MATRIX_MODE_SCROLL;
 uint8_t matrix_btns, matrix_prev_btns;
 uint16_t audio_l, audio_r;
-Adafruit_SSD1306 oled(128, 32, &Wire, -1);
+SSD1306Async oled(128, 32, &Wire);
 int oled_scrollpos = -128;
 
 void matrix_init()
@@ -173,8 +180,6 @@ void matrix_init()
 
 void setup()
 {
-  queue_init(&spi_event_queue, sizeof(queue_spi_t), 64);
-
   hw_setup.debug_enabled = true;
 
 #if ENABLE_MSC
@@ -231,7 +236,7 @@ void setup()
   // I2C
   Wire.setSDA(PIN_I2C_SDA);
   Wire.setSCL(PIN_I2C_SCL);
-  Wire.setClock(100000);
+  Wire.setClock(400000); // fast mode, all the devices on the bus support it
   Wire.begin();
 
 #if WAIT_SERIAL
@@ -289,7 +294,7 @@ void setup()
   }
 
   zxrtc.begin(spi_send, on_time);
-  zxosd.begin(spi_send);
+  zxosd.begin(spi_send, spi_send_burst);
   ft.begin(spi_send);
 
   has_fs = false;
@@ -348,6 +353,8 @@ void setup()
     osd_state = state_core_browser;
     app_core_browser_read_list();
   }
+
+  loop_tasks_init();
 }
 
 void setup1() {
@@ -363,64 +370,13 @@ void setup1() {
   tuh_init(1);
 }
 
-void loop()
-{
-  //rp2040.wdt_reset();
-  // read hw buttons to manipulate msc / reboots
+static void task_buttons() {
+  // read hw buttons
   static bool prev_btn1 = false;
   static bool prev_btn2 = false;
   bool btn1 = btn_read(0);
   bool btn2 = btn_read(1);
 
-  // if eject event registered - reboot rp2040
-  if (ejected) {
-    ejected = false;
-    rp2040.reboot();
-  }
-
-#if ENABLE_MSC
-  // if msc mounted but btn1 pressed - also reboot rp2040
-  if (expose_msc) {
-
-    if (my_timer2.elapsed() >= 200) {
-          msc_blink = !msc_blink;
-        led_write(1, msc_blink);
-        my_timer2.reset();
-    }
-
-    if (btn1 && my_timer.elapsed() > 10000) {
-      // wait for btn1 to release
-      while(btn1) { btn1 = btn_read(0); delay(100); }
-      expose_msc = false;
-      rp2040.reboot();
-    }
-
-    // do not process other loop things until exit from msc mode
-    return;
-  }
-#endif
-
-  zxrtc.handle();
-
-  // set is_osd off after 200ms of real switching off 
-  // to avoid esc keypress passes to the host
-  if (is_osd_hiding && hide_timer.elapsed() >= 200) {
-    is_osd = false;
-    is_osd_hiding = false;
-  }
-
-  // hide popup after 500 ms
-  if (is_popup_hiding && popup_timer.elapsed() >= 500) {
-    is_popup_hiding = false;
-    zxosd.hidePopup();
-    osd_handle(true); // reinit osd
-  }
-
-  if (my_timer.elapsed() >= 100) {
-      led_write(0, true);
-      my_timer.reset();
-  }
-
   if (prev_btn1 != btn1) {
     d_print("Button 1: "); d_println((btn1) ? "on" : "off");
     prev_btn1 = btn1;
@@ -447,7 +403,9 @@ void loop()
       d_flush();
       rp2040.rebootToBootloader();
   }*/
+}
 
+static void task_joy() {
   // joy reading
 #if HW_ID == HW_ID_GO
   joyL = sega.getState(true);
@@ -487,40 +445,48 @@ void loop()
     on_keyboard();
   }
   prev_kb_repeat_state = kb_repeat_state;
+}
 
-  osd_handle(false);
-
-  queue_spi_t packet;
-	while (queue_try_remove(&spi_event_queue, &packet)) {
-    // skip keyboard transmission when osd is active
-    if (packet.cmd == CMD_USB_KBD) {
+static void task_events() {
+  spi_event_t events[SPI_EVENTS_BATCH];
+  uint16_t events_len;
+  while ((events_len = spi_events_drain(events, SPI_EVENTS_BATCH)) > 0) {
+    for (uint16_t ev = 0; ev < events_len; ev++) {
+      spi_event_t &packet = events[ev];
+      // skip keyboard transmission when osd is active
+      if (packet.cmd == CMD_USB_KBD) {
 #if HW_ID==HW_ID_GO
-      if (has_extender) extender.digitalWrite(PIN_EXT_LED2, !(usb_keyboard_report.modifier != 0 || usb_keyboard_report.keycode[0] != 0));
+        if (has_extender) extender.digitalWrite(PIN_EXT_LED2, !(usb_keyboard_report.modifier != 0 || usb_keyboard_report.keycode[0] != 0));
 #elif HW_ID==HW_ID_MINI || HW_ID==HW_ID_MINIG
-      digitalWrite(PIN_LED2, !(usb_keyboard_report.modifier != 0 || usb_keyboard_report.keycode[0] != 0));
+        digitalWrite(PIN_LED2, !(usb_keyboard_report.modifier != 0 || usb_keyboard_report.keycode[0] != 0));
 #endif
-      if (packet.addr == 1 && packet.data != 0) {
-          on_keyboard();
-      }
-      if (!is_osd) {
-        spi_send(packet.cmd, packet.addr, packet.data);
-      }
-    // skip ps/2 scancode transmission when osd is active
-    } else if (packet.cmd == CMD_PS2_SCANCODE) {
-      if (!is_osd) {
-        spi_send(packet.cmd, packet.addr, packet.data);
+        if (packet.addr == 1 && packet.data != 0) {
+            on_keyboard();
+        }
+        if (!is_osd) {
+          spi_send(packet.cmd, packet.addr, packet.data);
+        }
+      // skip ps/2 scancode transmission when osd is active
+      } else if (packet.cmd == CMD_PS2_SCANCODE) {
+        if (!is_osd) {
+          spi_send(packet.cmd, packet.addr, packet.data);
+        }
+      // skip joystick transmission when osd is active
+      } else if (packet.cmd == CMD_JOYSTICK) {
+        if (!is_osd) {
+          spi_send(packet.cmd, packet.addr, packet.data);
+        }
       }
-    // skip joystick transmission when osd is active
-    } else if (packet.cmd == CMD_JOYSTICK) {
-      if (!is_osd) {
+      else {
         spi_send(packet.cmd, packet.addr, packet.data);
       }
     }
-    else {
-      spi_send(packet.cmd, packet.addr, packet.data);
-    }
   }
+}
 
+// fpga inbound commands arrive with the replies, the esp handler sends
+// a NOP when there is nothing to transmit
+static void task_fpga_poll() {
   if (Serial.available() > 0) {
     // receive at least on the serial_speed
     unsigned long uart_rx_delay = 30 * 1e6 / serial_speed;
@@ -541,75 +507,170 @@ void loop()
   //if (esp_serial.available()) {
   //  Serial.write(esp_serial.read());
   //}
+}
+
+static void task_rtc() {
+  zxrtc.handle();
+}
+
+static void task_osd() {
+  // set is_osd off after 200ms of real switching off 
+  // to avoid esc keypress passes to the host
+  if (is_osd_hiding && hide_timer.elapsed() >= 200) {
+    is_osd = false;
+    is_osd_hiding = false;
+  }
+
+  // hide popup after 500 ms
+  if (is_popup_hiding && popup_timer.elapsed() >= 500) {
+    is_popup_hiding = false;
+    zxosd.hidePopup();
+    osd_handle(true); // reinit osd
+  }
+
+  osd_handle(false);
 
   if (core.type == CORE_TYPE_BOOT && has_ft == true && is_osd == true) {
     // todo: playSound
     // todo: timer
   }
+}
 
-  if (has_matrix && matrix_timer.elapsed() >= 20) {
-    matrix_timer.reset();
+static void task_led() {
+  led_write(0, true);
+}
 
-    switch (matrix_mode) {
-      case MATRIX_MODE_AUDIO:
-        matrix_draw_audio();
-        break;
-      case MATRIX_MODE_SCROLL:
-        if (matrix_scroll_timer.elapsed() >= 100) {
-          matrix_scroll_timer.reset();
-          matrix_scroll_text();
-        }
-        break;
-    }
+static void task_ft() {
+  if (has_ft) ft.tick();
+}
 
-    static bool prev_matrix_btn1 = false;
-    static bool prev_matrix_btn2 = false;
-    static bool prev_matrix_btn3 = false;
-    static bool prev_matrix_btn4 = false;
-
-    // poll HT16k33 for buttons
-    if (matrix_poll_timer.elapsed() >= 100) {
-      matrix_poll_timer.reset();
-      uint8_t matrix_btns = matrix.readKeys();
-      bool matrix_btn1 = bitRead(matrix_btns, 0);
-      bool matrix_btn2 = bitRead(matrix_btns, 1);
-      bool matrix_btn3 = bitRead(matrix_btns, 2);
-      bool matrix_btn4 = bitRead(matrix_btns, 3);
-      if (prev_matrix_btn1 != matrix_btn1) {
-        d_print("Matrix Button 1: "); d_println((matrix_btn1) ? "on" : "off");
-        prev_matrix_btn1 = matrix_btn1;
-        spi_send(CMD_MATRIX_BTN, 0, matrix_btn1);
-      }
-      if (prev_matrix_btn2 != matrix_btn2) {
-        d_print("Matrix Button 2: "); d_println((matrix_btn2) ? "on" : "off");
-        prev_matrix_btn2 = matrix_btn2;
-        spi_send(CMD_MATRIX_BTN, 1, matrix_btn2);
-      }
-      if (prev_matrix_btn3 != matrix_btn3) {
-        d_print("Matrix Button 3: "); d_println((matrix_btn3) ? "on" : "off");
-        prev_matrix_btn3 = matrix_btn3;
-        spi_send(CMD_MATRIX_BTN, 2, matrix_btn3);
-      }
-      if (prev_matrix_btn4 != matrix_btn4) {
-        d_print("Matrix Button 4: "); d_println((matrix_btn4) ? "on" : "off");
-        prev_matrix_btn4 = matrix_btn4;
-        spi_send(CMD_MATRIX_BTN, 3, matrix_btn4);
+static void task_scan() {
+  app_file_loader_on_scan();
+}
+
+static void task_matrix_buttons() {
+  if (!has_matrix) return;
+
+  static bool prev_matrix_btn1 = false;
+  static bool prev_matrix_btn2 = false;
+  static bool prev_matrix_btn3 = false;
+  static bool prev_matrix_btn4 = false;
+
+  // poll HT16k33 for buttons
+  uint8_t matrix_btns = matrix.readKeys();
+  bool matrix_btn1 = bitRead(matrix_btns, 0);
+  bool matrix_btn2 = bitRead(matrix_btns, 1);
+  bool matrix_btn3 = bitRead(matrix_btns, 2);
+  bool matrix_btn4 = bitRead(matrix_btns, 3);
+  if (prev_matrix_btn1 != matrix_btn1) {
+    d_print("Matrix Button 1: "); d_println((matrix_btn1) ? "on" : "off");
+    prev_matrix_btn1 = matrix_btn1;
+    spi_send(CMD_MATRIX_BTN, 0, matrix_btn1);
+  }
+  if (prev_matrix_btn2 != matrix_btn2) {
+    d_print("Matrix Button 2: "); d_println((matrix_btn2) ? "on" : "off");
+    prev_matrix_btn2 = matrix_btn2;
+    spi_send(CMD_MATRIX_BTN, 1, matrix_btn2);
+  }
+  if (prev_matrix_btn3 != matrix_btn3) {
+    d_print("Matrix Button 3: "); d_println((matrix_btn3) ? "on" : "off");
+    prev_matrix_btn3 = matrix_btn3;
+    spi_send(CMD_MATRIX_BTN, 2, matrix_btn3);
+  }
+  if (prev_matrix_btn4 != matrix_btn4) {
+    d_print("Matrix Button 4: "); d_println((matrix_btn4) ? "on" : "off");
+    prev_matrix_btn4 = matrix_btn4;
+    spi_send(CMD_MATRIX_BTN, 3, matrix_btn4);
+  }
+}
+
+static void task_matrix() {
+  if (!has_matrix) return;
+
+  switch (matrix_mode) {
+    case MATRIX_MODE_AUDIO:
+      matrix_draw_audio();
+      break;
+    case MATRIX_MODE_SCROLL:
+      if (matrix_scroll_timer.elapsed() >= 100) {
+        matrix_scroll_timer.reset();
+        matrix_scroll_text();
       }
-    }
+      break;
   }
+}
 
-  if (has_oled && oled_timer.elapsed() >= 20) {
-    oled_timer.reset();
-    if (oled_scrollpos >= -112) {
-      oled_scrollpos--;
-    } else {
-      oled_scrollpos = 128;
+// next logo frame, once the previous one is on the panel
+static void task_oled() {
+  if (!has_oled || oled.busy()) return;
+
+  if (oled_scrollpos >= -112) {
+    oled_scrollpos--;
+  } else {
+    oled_scrollpos = 128;
+  }
+  oled.clearDisplay();
+  oled.drawBitmap(oled_scrollpos, 0, logoBw, 112, 32, WHITE); // karabas go logo 112x32 bw
+}
+
+// send changed oled columns, one short i2c transaction per pass
+static void task_oled_tx() {
+  if (has_oled) oled.tick();
+}
+
+void loop_tasks_init() {
+  sched_add("events", task_events, 0, sched_prio_input);
+  sched_add("joy", task_joy, 0, sched_prio_input);
+  sched_add("buttons", task_buttons, 10000, sched_prio_input);
+  sched_add("fpga_poll", task_fpga_poll, 0, sched_prio_io);
+  sched_add("rtc", task_rtc, 0, sched_prio_io);
+  sched_add("matrix_btn", task_matrix_buttons, 100000, sched_prio_io);
+  sched_add("osd", task_osd, 0, sched_prio_ui);
+  sched_add("led", task_led, 100000, sched_prio_ui);
+  sched_add("ft", task_ft, 10000, sched_prio_ui);
+  sched_add("scan", task_scan, 0, sched_prio_ui);
+  sched_add("matrix", task_matrix, 20000, sched_prio_cosmetic);
+  sched_add("oled", task_oled, 20000, sched_prio_cosmetic);
+  sched_add("oled_tx", task_oled_tx, 0, sched_prio_cosmetic);
+}
+
+void loop()
+{
+  //rp2040.wdt_reset();
+
+  // if eject event registered - reboot rp2040
+  if (ejected) {
+    ejected = false;
+    rp2040.reboot();
+  }
+
+#if ENABLE_MSC
+  // if msc mounted but btn1 pressed - also reboot rp2040
+  if (expose_msc) {
+    bool btn1 = btn_read(0);
+
+    if (my_timer2.elapsed() >= 200) {
+          msc_blink = !msc_blink;
+        led_write(1, msc_blink);
+        my_timer2.reset();
     }
-    oled.clearDisplay();
-    oled.drawBitmap(oled_scrollpos, 0, logoBw, 112, 32, WHITE); // karabas go logo 112x32 bw
-    oled.display(); // show default adafruit buffer
+
+    if (btn1 && my_timer.elapsed() > 10000) {
+      // wait for btn1 to release
+      while(btn1) { btn1 = btn_read(0); delay(100); }
+      expose_msc = false;
+      rp2040.reboot();
+    }
+
+    // do not process other loop things until exit from msc mode
+    return;
   }
+#endif
+
+  sched_run();
 
+  // one osd transfer per pass, whatever the tasks have drawn
+  zxosd.flush();
 }
 
 void loop1()
@@ -628,36 +689,47 @@ void do_configure(const char* filename) {
   ft.spi(false);
   kb_reset(); // reset to ps/2 defaults
 
+  prof_begin(filename);
   fpga_send(filename);
   spi_send(CMD_INIT_START, 0, 0);
   spi_send(CMD_HW_SETUP, 0, HW_ID); // hw id
   spi_send(CMD_HW_SETUP, 1, hw_setup.dvi_only); // dvi only flag
   // trigger font loader reset
+  prof_start(prof_font);
   zxosd.fontReset();
   // send font data
   for (int i=0; i<OSD_FONT_SIZE; i++) {
     zxosd.fontSend(osd_font[i]);
   }
+  prof_stop(prof_font);
+  prof_start(prof_core);
   read_core(filename);
+  prof_stop(prof_core);
+  prof_start(prof_osd);
   if (!is_osd) {
     zxosd.clear();
     zxosd.logo(0,0, HW_ID);
     zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
     zxosd.setPos(0,5);
     zxosd.print("ROM ");
-    zxosd.update();
+    zxosd.update(true);
     zxosd.showPopup();
   }
+  prof_stop(prof_osd);
+  prof_start(prof_roms);
   read_roms(filename);
+  prof_stop(prof_roms);
+  prof_start(prof_osd);
   if (!is_osd) {
     zxosd.hidePopup();
     osd_handle(true); // reinit osd
   }
+  prof_stop(prof_osd);
+  spi_events_flush(); // drop input queued for the previous core
+  spi_send(CMD_INIT_DONE, 0, 0);
   for (uint8_t i=0; i<6; i++) { // cleanup kbd
-    spi_queue(CMD_USB_KBD, i, 0);
+    spi_send(CMD_USB_KBD, i, 0);
   }
-  spi_send(CMD_INIT_DONE, 0, 0);
-  queue_locked = false;
   is_flashboot = false;
   is_configuring = false;
 
@@ -670,6 +742,10 @@ void do_configure(const char* filename) {
     audio_l = 32000;
     audio_r = 32000;
   }
+
+  prof_end();
+  prof_dump_last();
+  sched_reset_stats(); // loop latency since the last core switch
 }
 
 bool on_global_hotkeys() {
@@ -850,23 +926,29 @@ uint32_t fpga_send(const char* filename) {
 
   d_print("Configuring FPGA by "); d_println(filename);
 
+  prof_start(prof_sd_open);
   sd1.chvol();
   if (!file1.open(filename, FILE_READ)) {
     halt("Unable to open bitstream file to read");
   }
 
-  // get bitstream size
+  // get bitstream size (packed size for compressed containers)
   uint32_t length = file_read32(FILE_POS_BITSTREAM_LEN);
-  d_print("Bitstream size: "); d_println(length, DEC);
+  file_seek(FILE_POS_COMPRESSION);
+  bool is_packed = bitRead(file_read(), 0);
+  d_print("Bitstream size: "); d_print(length, DEC); d_println(is_packed ? " (packed)" : "");
+
+  // link protocol features of the new bitstream, needed right after configuration (font upload)
+  file_seek(FILE_POS_CORE_FEATURES);
+  core.features = file_read();
+  d_print("Core features: "); d_println(core.features, HEX);
+  zxosd.setStream(bitRead(core.features, CORE_FEATURE_OSD_STREAM));
+  zxosd.invalidate(); // new bitstream, osd ram contents are unknown
 
   // seek to bitstream start
   file_seek(FILE_POS_BITSTREAM_START);
-
-  pinMode(PIN_CONF_CLK, OUTPUT);
-  pinMode(PIN_CONF_IO1, OUTPUT);
-
-  pinMode(PIN_CONF_CLK, OUTPUT);
-  pinMode(PIN_CONF_IO1, OUTPUT);
+  file_section_begin(length, is_packed);
+  prof_stop(prof_sd_open);
 
   // pulse PROG_B
   digitalWrite(PIN_CONF_PRG_B, HIGH);
@@ -876,75 +958,70 @@ uint32_t fpga_send(const char* filename) {
   // wait for INIT_B = 0
   delay(10);
 
+  if (!fpga_loader.begin(PIN_CONF_IO1, PIN_CONF_CLK, CONF_CCLK_FREQ)) {
+    halt("Unable to start bitstream loader");
+  }
+
   my_timer.reset();
+  prof_start(prof_bitstream);
 
-  int i = 0;
+  uint32_t i = 0;
+  uint32_t progress = 0;
   bool blink = false;
-  char line[128];
-  uint8_t n;
-
-  digitalWrite(PIN_CONF_CLK, LOW);
+  uint8_t buf_idx = 0;
+  int n;
 
-  while ((n = file_read_buf(line, (sizeof(line) < length ? sizeof(line) : length) ))) {
+  // read (and unpack) next chunk from SD while dma+pio are clocking out the previous one
+  while ((n = file_section_read(conf_buf[buf_idx], CONF_BUF_SIZE)) > 0) {
+    fpga_loader.write(conf_buf[buf_idx], n);
+    buf_idx ^= 1;
     i += n;
-    length -=n;
-
-    for (uint8_t s=0; s<n; s++) {
-      uint8_t c = line[s];
-      for (uint8_t j=0; j<8; ++j) {
-        // Set bit of data
-        gpio_put(PIN_CONF_IO1, (c & (1<<(7-j))) ? HIGH : LOW);
-        // Latch bit of data by CCLK impulse
-        gpio_put(PIN_CONF_CLK, HIGH);
-        gpio_put(PIN_CONF_CLK, LOW);
-      }
-    }
 
-    if ((i % 8192 == 0) || (i == length-1)) {
+    uint32_t pos = file_section_pos();
+    if ((pos - progress >= 8192) || (pos == length)) {
+      progress = pos;
       blink = !blink;
       led_write(0, blink);
       led_write(1, blink);
       if (has_matrix) {
-        matrix.drawLine(0, 0, map(i, 0, length, 0, 15), 0, LED_GREEN);
-        matrix.drawLine(0, 1, map(i, 0, length, 0, 15), 1, LED_GREEN);
+        matrix.drawLine(0, 0, map(pos, 0, length, 0, 15), 0, LED_GREEN);
+        matrix.drawLine(0, 1, map(pos, 0, length, 0, 15), 1, LED_GREEN);
         matrix.writeDisplay();
       }
     }
   }
+  // flush the last chunk and release CCLK / DIN pins
+  fpga_loader.end();
   file1.close();
-
-  pinMode(PIN_CONF_CLK, INPUT);
-  pinMode(PIN_CONF_IO1, INPUT);
-
-  pinMode(PIN_CONF_CLK, INPUT);
-  pinMode(PIN_CONF_IO1, INPUT);
+  prof_stop(prof_bitstream);
 
   d_print(i, DEC); d_println(" bytes done");
   d_print("Elapsed time: "); d_print(my_timer.elapsed(), DEC); d_println(" ms");
   d_flush();
 
   d_print("Waiting for CONF_DONE... ");
+  prof_start(prof_conf_done);
   while(digitalRead(PIN_CONF_DONE) == LOW) {
     delay(10);
   }
+  prof_stop(prof_conf_done);
   d_println("Done");
 
-  return length;
+  return i;
 }
 
 void spi_queue(uint8_t cmd, uint8_t addr, uint8_t data) {
-  queue_spi_t packet;
-  packet.cmd = cmd;
-  packet.addr = addr;
-  packet.data = data;
-  if (!queue_locked)
-    queue_try_add(&spi_event_queue, &packet);
+  spi_events_push(cmd, addr, data);
 }
 
-void spi_send(uint8_t cmd, uint8_t addr, uint8_t data) {
+SPISettings spi_get_settings() {
   // use default (16 MHz) or custom spi freq from the core config
-  SPISettings spi_settings = (core.spi_freq == 0 || core.spi_freq == 255) ? settingsA : SPISettings(SD_SCK_MHZ(core.spi_freq), MSBFIRST, SPI_MODE0);
-  SPI.beginTransaction(spi_settings);
+  return (core.spi_freq == 0 || core.spi_freq == 255) ? settingsA : SPISettings(SD_SCK_MHZ(core.spi_freq), MSBFIRST, SPI_MODE0);
+}
+
+void spi_send(uint8_t cmd, uint8_t addr, uint8_t data) {
+  spi_stream_wait(); // SPI0 is owned by the stream dma until drained
+  SPI.beginTransaction(spi_get_settings());
   gpio_put(PIN_MCU_SPI_CS, LOW);
   uint8_t rx_cmd = SPI.transfer(cmd);
   uint8_t rx_addr = SPI.transfer(addr);
@@ -956,6 +1033,59 @@ void spi_send(uint8_t cmd, uint8_t addr, uint8_t data) {
   }
 }
 
+// send len bytes as (cmd, addr+i, buf[i]) sequence
+// using CMD_BURST frames (up to 256 bytes each) when the core supports them
+void spi_send_burst(uint8_t cmd, uint8_t addr, const uint8_t *buf, uint16_t len) {
+  if (!bitRead(core.features, CORE_FEATURE_BURST)) {
+    for (uint16_t i=0; i<len; i++) {
+      spi_send(cmd, addr + i, buf[i]);
+    }
+    return;
+  }
+  spi_stream_wait();
+  while (len > 0) {
+    uint16_t n = (len > 256) ? 256 : len;
+    SPI.beginTransaction(spi_get_settings());
+    gpio_put(PIN_MCU_SPI_CS, LOW);
+    // fpga replies to the frame header the same way as to a regular command
+    uint8_t rx_cmd = SPI.transfer(CMD_BURST);
+    uint8_t rx_addr = SPI.transfer(cmd);
+    uint8_t rx_data = SPI.transfer(addr);
+    SPI.transfer((uint8_t)(n - 1));
+    SPI.transfer(buf, nullptr, n);
+    gpio_put(PIN_MCU_SPI_CS, HIGH);
+    SPI.endTransaction();
+    if ((rx_cmd > 0) && !is_configuring) {
+      process_in_cmd(rx_cmd, rx_addr, rx_data);
+    }
+    buf += n;
+    addr += n;
+    len -= n;
+  }
+}
+
+// send a data block into the 256-byte banked address space of the fpga side
+// (roms, file loader, ioctl): 3-byte bank address on every 256 byte boundary,
+// then lower address byte + data
+void spi_send_banked(uint8_t bank_cmd, uint8_t data_cmd, uint32_t addr, const uint8_t *buf, uint32_t len) {
+  while (len > 0) {
+    if ((addr & 0xFF) == 0) {
+      uint8_t bank[3];
+      bank[0] = (uint8_t)((addr & 0x0000FF00) >> 8);
+      bank[1] = (uint8_t)((addr & 0x00FF0000) >> 16);
+      bank[2] = (uint8_t)((addr & 0xFF000000) >> 24);
+      spi_send_burst(bank_cmd, 0, bank, sizeof(bank));
+    }
+    // up to the end of current bank
+    uint32_t n = 256 - (addr & 0xFF);
+    if (n > len) n = len;
+    spi_send_burst(data_cmd, (uint8_t)(addr & 0xFF), buf, n);
+    addr += n;
+    buf += n;
+    len -= n;
+  }
+}
+
 void spi_send16(uint8_t cmd, uint16_t data) {
   uint8_t byte2 = (uint8_t)((data & 0xFF00) >> 8);
   uint8_t byte1 = (uint8_t)((data & 0x00FF));
@@ -1014,8 +1144,9 @@ void flashboot (uint8_t data) {
   //String f = String(core.filename); f.trim(); 
   //d_printf("Loading core %s", f); d_println();
   //char buf[33]; f.toCharArray(buf, sizeof(buf));
-  String id = String(core.id); id.trim();
-  if (id.compareTo("zxnext") == 0) { // allow flashboot only for zxnext core
+  char id[sizeof(core.id)];
+  str_copy(id, sizeof(id), core.id); str_trim(id);
+  if (strcmp(id, "zxnext") == 0) { // allow flashboot only for zxnext core
     is_flashboot = true;
     do_configure(core.filename);
   }
@@ -1091,12 +1222,15 @@ void matrix_pixel_data(uint8_t x, uint8_t y, uint8_t color) {
 
 void matrix_bitplan_data(uint8_t addr, uint8_t data) {
   if (has_matrix) {
-    // todo:
     // addr 0-7:   matrix1, red
     // addr 8-15:  matrix1, green
     // addr 16-23: matrix2, red
     // addr 24-31: matrix2, green
-    //matrix.drawBitmap()
+    matrix.setBitplane(addr, data);
+    // the last byte completes the frame, only changed rows go to the chips
+    if (addr == 31) {
+      matrix.writeDisplay();
+    }
   }
 }
 
@@ -1183,7 +1317,6 @@ void print_time() {
   zxosd.setPos(24, 0);
   zxosd.setColor(OSD::COLOR_WHITE, OSD::COLOR_BLACK);
   static bool dots_blink = !dots_blink;
-  String dots = String(dots_blink ? ':' : ' ');
   uint8_t h = zxrtc.getHour();
   uint8_t m = zxrtc.getMinute();
   uint8_t s = zxrtc.getSecond();
@@ -1211,8 +1344,8 @@ void on_time() {
   app_core_browser_on_time();
   app_setup_on_time();
 
-  if (core.type == CORE_TYPE_BOOT && has_ft == true && is_osd == true) {
-    // redraw core browser
+  if (core.type == CORE_TYPE_BOOT && has_ft == true && is_osd == true && ft.frameDone()) {
+    // redraw core browser, skipped while the previous frame is still rendering
     app_core_browser_ft_menu(0);
   }
 }
@@ -1285,15 +1418,16 @@ void read_core(const char* filename) {
       file_read_bytes(file_slots[core.osd[i].slot_id].ext, 256); file_slots[core.osd[i].slot_id].ext[255] = '\0';
       file_slots[core.osd[i].slot_id].offset_dir = file1.curPosition();
       file_read_bytes(file_slots[core.osd[i].slot_id].dir, 256); file_slots[core.osd[i].slot_id].dir[255] = '\0';
-      String dir = String(file_slots[core.osd[i].slot_id].dir);
-      if (dir == "") { dir = "/"; }
-      if (dir.charAt(0) != '/') { dir = '/' + dir; }
-      dir.toCharArray(file_slots[core.osd[i].slot_id].dir, sizeof(file_slots[core.osd[i].slot_id].dir));
+      char dir[sizeof(file_slots[0].dir)];
+      path_dir(dir, sizeof(dir), file_slots[core.osd[i].slot_id].dir);
+      strcpy(file_slots[core.osd[i].slot_id].dir, dir);
       file_slots[core.osd[i].slot_id].offset_filename = file1.curPosition();
       file_read_bytes(file_slots[core.osd[i].slot_id].filename, 256); file_slots[core.osd[i].slot_id].filename[255] = '\0';
-      String sfilename = String( file_slots[core.osd[i].slot_id].filename); sfilename.trim();
-      String sfullname = dir + "/" + sfilename; sfullname.trim();
-      if (sfilename.length() > 0 && sd1.exists(sfullname)) {
+      char sfilename[sizeof(file_slots[0].filename)];
+      str_copy(sfilename, sizeof(sfilename), file_slots[core.osd[i].slot_id].filename); str_trim(sfilename);
+      static char sfullname[sizeof(dir) + sizeof(sfilename)];
+      path_join(sfullname, sizeof(sfullname), dir, sfilename);
+      if (sfilename[0] != '\0' && sd1.exists(sfullname)) {
         file_slots[core.osd[i].slot_id].is_mounted = true; //file_slots[core.osd[i].slot_id].file = sd1.open(sfullname, O_READ);
         if (file_slots[core.osd[i].slot_id].is_autoload) {
           // todo: autoload (spi commands to the host)
@@ -1372,7 +1506,7 @@ void read_core(const char* filename) {
         ft.spi(true);
         has_ft = ft.init(hw_setup.ft_video_mode);
         if (has_ft) {
-          d_println("Found FT81x IC, switching to FT OSD");
+          d_printf("Found FT81x IC (SPI %lu Hz), switching to FT OSD", (unsigned long) ft.spiClock()); d_println();
           ft.vga(true);
         } else {
           d_println("FT81x IC did not found");
@@ -1399,13 +1533,13 @@ void read_core(const char* filename) {
   // mount slots
   for(uint8_t i=0; i<core.osd_len; i++) {
     if (core.osd[i].type == CORE_OSD_TYPE_FILEMOUNTER) {
-      String dir = String(file_slots[core.osd[i].slot_id].dir);
-      if (dir == "") { dir = "/"; }
-      if (dir.charAt(0) != '/') { dir = '/' + dir; }
-      dir.toCharArray(file_slots[core.osd[i].slot_id].dir, sizeof(file_slots[core.osd[i].slot_id].dir));
-      String sfilename = String( file_slots[core.osd[i].slot_id].filename);
-      String sfullname = dir + "/" + sfilename;
-      if (sfilename.length() > 0 && sd1.exists(sfullname)) {
+      char dir[sizeof(file_slots[0].dir)];
+      path_dir(dir, sizeof(dir), file_slots[core.osd[i].slot_id].dir);
+      strcpy(file_slots[core.osd[i].slot_id].dir, dir);
+      const char* sfilename = file_slots[core.osd[i].slot_id].filename;
+      static char sfullname[sizeof(dir) + sizeof(file_slots[0].filename)];
+      path_join(sfullname, sizeof(sfullname), dir, sfilename);
+      if (sfilename[0] != '\0' && sd1.exists(sfullname)) {
         // todo
         //file_slots[core.osd[i].slot_id].is_mounted = file_slots[core.osd[i].slot_id].file = sd1.open(sfullname, O_READ);
       }
@@ -1423,6 +1557,14 @@ void read_core(const char* filename) {
   osd_handle(true);
 }
 
+static void rom_progress(uint32_t rom_idx, uint32_t sent) {
+  zxosd.setPos(4,5+rom_idx);
+  zxosd.print(rom_idx+1); zxosd.print(": ");
+  char b[40];
+  sprintf(b, "%05d", (int) sent); zxosd.print(b); zxosd.print(" ");
+  zxosd.update(true);
+}
+
 void read_roms(const char* filename) {
 
   sd1.chvol();
@@ -1432,7 +1574,9 @@ void read_roms(const char* filename) {
 
   uint32_t bitstream_length = file_read32(FILE_POS_BITSTREAM_LEN);
   uint32_t roms_len = file_read32(FILE_POS_ROM_LEN);
-  d_print("ROMS len "); d_println(roms_len);
+  file_seek(FILE_POS_COMPRESSION);
+  bool is_packed = bitRead(file_read(), 1);
+  d_print("ROMS len "); d_print(roms_len); d_println(is_packed ? " (packed)" : "");
   if (roms_len > 0) {
     spi_send(CMD_ROMLOADER, 0, 1);
   }
@@ -1445,85 +1589,61 @@ void read_roms(const char* filename) {
     uint32_t rom_addr = file_read32(FILE_POS_BITSTREAM_START + bitstream_length + offset + 4);
     d_print("ROM #"); d_print(rom_idx); d_print(": addr="); d_print(rom_addr); d_print(", len="); d_println(rom_len);
     if (rom_is_external) {
+      // external rom: descriptor payload is a NUL padded path,
+      // relative to the core file unless it starts with '/'
       char rom_filename[256];
+      char rom_path[256];
+      file_seek(FILE_POS_BITSTREAM_START + bitstream_length + offset + 8);
+      size_t path_len = file_read_bytes(rom_path, min(rom_len, (uint32_t) sizeof(rom_path) - 1));
+      rom_path[path_len] = '\0';
+      if (rom_path[0] == '/') {
+        strcpy(rom_filename, rom_path);
+      } else {
+        const char *slash = strrchr(filename, '/');
+        size_t dir_len = slash ? (size_t)(slash - filename) : 0;
+        snprintf(rom_filename, sizeof(rom_filename), "%.*s/%s", (int) dir_len, filename, rom_path);
+      }
       d_print("External ROM "); d_println(rom_filename);
 
-      // todo: read and send external rom from sd1
-      if (sd1.exists(rom_filename)) {
-        file2 = sd1.open(rom_filename, FILE_READ);
-        char buf[256];
-        int i=0;
-        while (int c = file2.read(buf, sizeof(buf))) {
-          for (int j=0; j<256; j++) {
-
-            uint32_t addr = rom_addr + i*256 + j;
-            uint8_t data = buf[j];
-
-            // send rombank address every 256 bytes
-              if (addr % 256 == 0) {
-                uint8_t rombank3 = (uint8_t)((addr & 0xFF000000) >> 24);
-                uint8_t rombank2 = (uint8_t)((addr & 0x00FF0000) >> 16);
-                uint8_t rombank1 = (uint8_t)((addr & 0x0000FF00) >> 8);
-                //d_printf("ROM bank %d %d %d", rombank1, rombank2, rombank3); d_println();
-                spi_send(CMD_ROMBANK, 0, rombank1);
-                spi_send(CMD_ROMBANK, 1, rombank2);
-                spi_send(CMD_ROMBANK, 2, rombank3);
-              }
-              // send lower 256 bytes
-              uint8_t romaddr = (uint8_t)((addr & 0x000000FF));
-              spi_send(CMD_ROMDATA, romaddr, data);
-
-          }
-          if (rom_len > 0) {
-            zxosd.setPos(4,5+rom_idx);
-            //uint8_t perc = ceil((float) i*256 * (100.0 / rom_len));
-            zxosd.print(rom_idx+1); zxosd.print(": ");
-            char b[40];
-            sprintf(b, "%05d", (i+1)*256); zxosd.print(b); zxosd.print(" ");
-            zxosd.update();
+      if (file2.open(rom_filename, FILE_READ)) {
+        spi_stream_begin(CMD_ROMBANK, CMD_ROMDATA, rom_addr);
+        uint32_t sent = 0;
+        uint8_t *buf;
+        int n;
+        // sector aligned reads straight into the stream buffers,
+        // short reads just commit what was read
+        while ((n = file2.read(buf = spi_stream_acquire(), SPI_STREAM_BUF_SIZE)) > 0) {
+          spi_stream_commit(buf, n);
+          sent += n;
+          if (sent % 4096 == 0) {
+            rom_progress(rom_idx, sent);
           }
-          i++;
         }
+        spi_stream_end();
         file2.close();
+        rom_progress(rom_idx, sent);
       } else {
         zxosd.setPos(4,5+rom_idx);
         zxosd.print(rom_idx+1); zxosd.print(": ");
         zxosd.print(" NO FILE");
-        zxosd.update();
+        zxosd.update(true);
       }
     } else {
-      for (uint32_t i=0; i<rom_len/256; i++) {
-        char buf[256];
-        int c = file_read_bytes(buf, sizeof(buf));
-        for (int j=0; j<256; j++) {
-
-          uint32_t addr = rom_addr + i*256 + j;
-          uint8_t data = buf[j];
-
-          // send rombank address every 256 bytes
-            if (addr % 256 == 0) {
-              uint8_t rombank3 = (uint8_t)((addr & 0xFF000000) >> 24);
-              uint8_t rombank2 = (uint8_t)((addr & 0x00FF0000) >> 16);
-              uint8_t rombank1 = (uint8_t)((addr & 0x0000FF00) >> 8);
-              //d_printf("ROM bank %d %d %d", rombank1, rombank2, rombank3); d_println();
-              spi_send(CMD_ROMBANK, 0, rombank1);
-              spi_send(CMD_ROMBANK, 1, rombank2);
-              spi_send(CMD_ROMBANK, 2, rombank3);
-            }
-            // send lower 256 bytes
-            uint8_t romaddr = (uint8_t)((addr & 0x000000FF));
-            spi_send(CMD_ROMDATA, romaddr, data);
-
-        }
-        if (rom_len > 0) {
-          zxosd.setPos(4,5+rom_idx);
-          //uint8_t perc = ceil((float) i*256 * (100.0 / rom_len));
-          zxosd.print(rom_idx+1); zxosd.print(": ");
-          char b[40];
-          sprintf(b, "%05d", (i+1)*256); zxosd.print(b); zxosd.print(" ");
-          zxosd.update();
+      // internal rom, optionally lzss packed (rom_len is the packed size then)
+      file_section_begin(rom_len, is_packed);
+      spi_stream_begin(CMD_ROMBANK, CMD_ROMDATA, rom_addr);
+      uint32_t sent = 0;
+      uint8_t *buf;
+      int n;
+      while ((n = file_section_read(buf = spi_stream_acquire(), SPI_STREAM_BUF_SIZE)) > 0) {
+        spi_stream_commit(buf, n);
+        sent += n;
+        if (sent % 4096 == 0) {
+          rom_progress(rom_idx, sent);
         }
       }
+      spi_stream_end();
+      rom_progress(rom_idx, sent);
     }
     offset = offset + rom_len + 8;
     roms_len = roms_len - rom_len - 8;
@@ -1532,7 +1652,7 @@ void read_roms(const char* filename) {
       // next rom
       zxosd.setPos(0, 5+rom_idx);
       zxosd.print("ROM ");
-      zxosd.update();
+      zxosd.update(true);
     }
   }
   //delay(100);
@@ -67,6 +67,9 @@ extern MultiMatrixDisplay matrix;
 
 void spi_queue(uint8_t cmd, uint8_t addr, uint8_t data);
 void spi_send(uint8_t cmd, uint8_t addr, uint8_t data);
+SPISettings spi_get_settings();
+void spi_send_burst(uint8_t cmd, uint8_t addr, const uint8_t *buf, uint16_t len);
+void spi_send_banked(uint8_t bank_cmd, uint8_t data_cmd, uint32_t addr, const uint8_t *buf, uint32_t len);
 void spi_send16(uint8_t cmd, uint16_t data);
 void spi_send24(uint8_t cmd, uint32_t data);
 void spi_send32(uint8_t cmd, uint32_t data);
@@ -74,6 +77,7 @@ void spi_send64(uint8_t cmd, uint64_t data);
 void process_in_cmd(uint8_t cmd, uint8_t addr, uint8_t data);
 
 void do_configure(const char* filename);
+void loop_tasks_init();
 uint32_t fpga_send(const char* filename);
 void halt(const char* msg);
 
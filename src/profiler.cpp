@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "main.h"
+#include "profiler.h"
+
+// per-phase timings of the last PROF_MAX_RUNS core switches, in microseconds
+
+typedef struct {
+  char name[33];
+  uint32_t total;
+  uint32_t phase[prof_phases];
+} prof_run_t;
+
+static const char* prof_names[prof_phases] = {"sd_open", "bitstream", "conf_done", "font", "core", "roms", "osd"};
+
+static prof_run_t prof_runs[PROF_MAX_RUNS];
+static uint8_t prof_head = 0;
+static uint8_t prof_count = 0;
+
+static prof_run_t prof_cur;
+static uint32_t prof_cur_start;
+static uint32_t prof_phase_start[prof_phases];
+static bool prof_active = false;
+
+void prof_begin(const char* name) {
+  memset(&prof_cur, 0, sizeof(prof_cur));
+  strncpy(prof_cur.name, name, sizeof(prof_cur.name)-1);
+  prof_active = true;
+  prof_cur_start = time_us_32();
+}
+
+void prof_start(uint8_t phase) {
+  if (!prof_active || phase >= prof_phases) return;
+  prof_phase_start[phase] = time_us_32();
+}
+
+void prof_stop(uint8_t phase) {
+  if (!prof_active || phase >= prof_phases) return;
+  // accumulate, a phase may be entered several times per run
+  prof_cur.phase[phase] += time_us_32() - prof_phase_start[phase];
+}
+
+void prof_end() {
+  if (!prof_active) return;
+  prof_cur.total = time_us_32() - prof_cur_start;
+  prof_runs[prof_head] = prof_cur;
+  prof_head = (prof_head + 1) % PROF_MAX_RUNS;
+  if (prof_count < PROF_MAX_RUNS) prof_count++;
+  prof_active = false;
+}
+
+static void prof_print_ms(uint32_t us) {
+  d_printf(" %7lu.%lu", (unsigned long) (us / 1000), (unsigned long) ((us % 1000) / 100));
+}
+
+static void prof_print_header() {
+  d_printf("%-2s %-16s", "#", "core");
+  for (uint8_t i=0; i<prof_phases; i++) {
+    d_printf(" %9s", prof_names[i]);
+  }
+  d_printf(" %9s", "total"); d_println();
+}
+
+static void prof_print_run(uint8_t n, const prof_run_t* run) {
+  d_printf("%-2d %-16.16s", n, run->name);
+  for (uint8_t i=0; i<prof_phases; i++) {
+    prof_print_ms(run->phase[i]);
+  }
+  prof_print_ms(run->total); d_println();
+}
+
+// dump all the stored runs, oldest first
+void prof_dump() {
+  d_printf("Core switch profile, ms (last %d)", prof_count); d_println();
+  prof_print_header();
+  for (uint8_t i=0; i<prof_count; i++) {
+    uint8_t idx = (prof_head + PROF_MAX_RUNS - prof_count + i) % PROF_MAX_RUNS;
+    prof_print_run(i+1, &prof_runs[idx]);
+  }
+  d_flush();
+}
+
+void prof_dump_last() {
+  if (prof_count == 0) return;
+  prof_print_header();
+  prof_print_run(prof_count, &prof_runs[(prof_head + PROF_MAX_RUNS - 1) % PROF_MAX_RUNS]);
+  d_flush();
+}
+
+// heap allocation counter.
+// arduino-pico already wraps malloc() & co for locking, so the newlib
+// reentrant entry points underneath are wrapped instead (-Wl,--wrap=... in
+// platformio.ini). It counts every allocation on both cores, including
+// the ones made by String and new. Each core counts in its own slot, an
+// increment is a plain read-modify-write and the cores do not share one
+
+static volatile uint32_t prof_allocs[2] = {0, 0};
+
+uint32_t prof_heap_allocs() {
+  return prof_allocs[0] + prof_allocs[1];
+}
+
+extern "C" {
+
+void* __real__malloc_r(struct _reent *r, size_t size);
+void* __real__realloc_r(struct _reent *r, void *ptr, size_t size);
+void* __real__calloc_r(struct _reent *r, size_t n, size_t size);
+
+void* __wrap__malloc_r(struct _reent *r, size_t size) {
+  prof_allocs[get_core_num()]++;
+  return __real__malloc_r(r, size);
+}
+
+void* __wrap__realloc_r(struct _reent *r, void *ptr, size_t size) {
+  prof_allocs[get_core_num()]++;
+  return __real__realloc_r(r, ptr, size);
+}
+
+void* __wrap__calloc_r(struct _reent *r, size_t n, size_t size) {
+  prof_allocs[get_core_num()]++;
+  return __real__calloc_r(r, n, size);
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define PROF_MAX_RUNS 8
+
+// do_configure phases
+enum prof_phase_e {
+  prof_sd_open = 0,
+  prof_bitstream,
+  prof_conf_done,
+  prof_font,
+  prof_core,
+  prof_roms,
+  prof_osd,
+  prof_phases
+};
+
+void prof_begin(const char* name);
+void prof_start(uint8_t phase);
+void prof_stop(uint8_t phase);
+void prof_end();
+void prof_dump();
+void prof_dump_last();
+
+uint32_t prof_heap_allocs();
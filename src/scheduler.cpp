@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "main.h"
+#include "scheduler.h"
+#include "profiler.h"
+
+// Cooperative main loop scheduler.
+//
+// Every sched_run() pass walks the tasks in priority order and runs the ones
+// whose deadline has passed (period 0 means every pass). Cosmetic tasks only
+// run while the pass is still within SCHED_BUDGET_US, and at most one of them
+// per pass, so a slow display refresh delays the next input poll by a single
+// refresh at worst. A cosmetic task deferred for longer than
+// SCHED_MAX_DEFER_US runs anyway.
+
+typedef struct {
+  const char* name;
+  sched_task_cb cb;
+  uint32_t period;
+  uint32_t due;
+  uint8_t prio;
+  uint32_t runs;
+  uint32_t deferred;
+  uint32_t max_us; // longest single run
+  uint32_t max_late_us; // worst start delay past the deadline
+  uint32_t allocs; // heap allocations made by the task
+} sched_task_t;
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_count = 0;
+
+static uint32_t sched_prev_pass = 0;
+static uint32_t sched_passes = 0;
+static uint32_t sched_max_loop_us = 0; // worst time between two passes
+static uint32_t sched_max_pass_us = 0;
+
+// tasks are kept sorted by priority, same priority keeps the order of adding
+void sched_add(const char* name, sched_task_cb cb, uint32_t period_us, uint8_t prio) {
+  if (sched_count >= SCHED_MAX_TASKS) {
+    d_print("Scheduler is full, task dropped: "); d_println(name);
+    return;
+  }
+  uint8_t pos = sched_count;
+  while (pos > 0 && sched_tasks[pos-1].prio > prio) {
+    sched_tasks[pos] = sched_tasks[pos-1];
+    pos--;
+  }
+  sched_tasks[pos] = {name, cb, period_us, time_us_32(), prio, 0, 0, 0, 0, 0};
+  sched_count++;
+}
+
+static void sched_exec(sched_task_t *t, uint32_t now) {
+  uint32_t late = now - t->due;
+  if (late > t->max_late_us) t->max_late_us = late;
+  // next deadline from the previous one, unless we fell a whole period behind
+  t->due = (late >= t->period) ? now + t->period : t->due + t->period;
+  uint32_t allocs = prof_heap_allocs();
+  t->cb();
+  t->allocs += prof_heap_allocs() - allocs;
+  uint32_t took = time_us_32() - now;
+  if (took > t->max_us) t->max_us = took;
+  t->runs++;
+}
+
+void sched_run() {
+  uint32_t start = time_us_32();
+  if (sched_passes > 0 && start - sched_prev_pass > sched_max_loop_us) {
+    sched_max_loop_us = start - sched_prev_pass;
+  }
+  sched_prev_pass = start;
+  sched_passes++;
+
+  bool cosmetic_done = false;
+  for (uint8_t i=0; i<sched_count; i++) {
+    sched_task_t *t = &sched_tasks[i];
+    uint32_t now = time_us_32();
+    if ((int32_t)(now - t->due) < 0) continue;
+    if (t->prio == sched_prio_cosmetic) {
+      bool overdue = (now - t->due) >= SCHED_MAX_DEFER_US;
+      if (!overdue && (cosmetic_done || now - start >= SCHED_BUDGET_US)) {
+        t->deferred++;
+        continue;
+      }
+      cosmetic_done = true;
+    }
+    sched_exec(t, now);
+  }
+
+  uint32_t took = time_us_32() - start;
+  if (took > sched_max_pass_us) sched_max_pass_us = took;
+}
+
+void sched_reset_stats() {
+  for (uint8_t i=0; i<sched_count; i++) {
+    sched_tasks[i].runs = 0;
+    sched_tasks[i].deferred = 0;
+    sched_tasks[i].max_us = 0;
+    sched_tasks[i].max_late_us = 0;
+    sched_tasks[i].allocs = 0;
+  }
+  sched_passes = 0;
+  sched_max_loop_us = 0;
+  sched_max_pass_us = 0;
+}
+
+void sched_dump() {
+  d_printf("Main loop: %lu passes, worst loop latency %lu us, worst pass %lu us",
+    (unsigned long) sched_passes, (unsigned long) sched_max_loop_us, (unsigned long) sched_max_pass_us); d_println();
+  d_printf("%-16s %4s %8s %10s %8s %8s %8s %8s", "task", "prio", "period", "runs", "deferred", "max_us", "late_us", "allocs"); d_println();
+  for (uint8_t i=0; i<sched_count; i++) {
+    sched_task_t *t = &sched_tasks[i];
+    d_printf("%-16.16s %4u %8lu %10lu %8lu %8lu %8lu %8lu", t->name, t->prio, (unsigned long) t->period,
+      (unsigned long) t->runs, (unsigned long) t->deferred, (unsigned long) t->max_us, (unsigned long) t->max_late_us,
+      (unsigned long) t->allocs); d_println();
+  }
+  d_flush();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define SCHED_MAX_TASKS 13
+
+// main loop task priorities, lower runs first
+enum sched_prio_e {
+  sched_prio_input = 0, // input forwarding to the fpga
+  sched_prio_io, // fpga inbound polling, uart, rtc
+  sched_prio_ui, // osd state machine, leds
+  sched_prio_cosmetic // matrix / oled refreshes, deferred when over budget
+};
+
+typedef void (*sched_task_cb)();
+
+void sched_add(const char* name, sched_task_cb cb, uint32_t period_us, uint8_t prio);
+void sched_run();
+void sched_reset_stats();
+void sched_dump();
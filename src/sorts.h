@@ -7,18 +7,16 @@
 #include <SPI.h>
 #include "config.h"
 
-inline bool operator<(const file_list_sort_item_t a, const file_list_sort_item_t b) {
-  String s1 = String(a.hash); String s2 = String(b.hash);
-  s1.toLowerCase(); s2.toLowerCase();
-  return s1 < s2;
+// precomputed collation key prefixes, ties keep dir order (see file_index_sort_ties())
+inline bool operator<(const file_list_sort_item_t &a, const file_list_sort_item_t &b) {
+  int c = memcmp(a.key, b.key, SORT_KEY_LEN);
+  return c < 0 || (c == 0 && a.file_id < b.file_id);
 }
 
 inline bool operator<(const core_list_item_t a, const core_list_item_t b) {
   return a.order < b.order;
 }
 
-inline bool operator<(const file_list_item_t a, const file_list_item_t b) {
-  String s1 = String(a.name); String s2 = String(b.name);
-  s1.toLowerCase(); s2.toLowerCase();
-  return s1 < s2;
+inline bool operator<(const file_list_item_t &a, const file_list_item_t &b) {
+  return strncasecmp(a.name, b.name, sizeof(a.name)) < 0;
 }
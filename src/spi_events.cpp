@@ -0,0 +1,127 @@
+#include <Arduino.h>
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "config.h"
+#include "types.h"
+#include "main.h"
+#include "spi_events.h"
+
+// Input events towards the fpga (usb hid, ps/2 scancodes).
+//
+// Every producer owns a single-producer/single-consumer ring, so pushes and
+// pops need no locks, only barriers between the index and the slot updates:
+//  - usb: the tinyusb host callbacks on core1
+//  - irq: the ps/2 repeat alarm, which fires in core0 interrupt context
+// The main loop on core0 is the only consumer, it drains both rings in batches,
+// merged by the push timestamp, so the fpga sees the events in their order.
+//
+// A full usb ring makes core1 wait up to SPI_EVENTS_WAIT_US for the main loop
+// instead of losing a key release. The irq producer can't wait on the loop it
+// has interrupted, it drops. Every drop is counted.
+
+typedef struct {
+  volatile uint32_t head __attribute__((aligned(32))); // written by the producer only
+  volatile uint32_t tail __attribute__((aligned(32))); // written by the consumer only
+  spi_events_stats_t stats;
+  uint32_t mask;
+  spi_event_t *buf;
+} spi_ring_t;
+
+static spi_event_t usb_buf[SPI_EVENTS_USB_SIZE] __attribute__((aligned(32)));
+static spi_event_t irq_buf[SPI_EVENTS_IRQ_SIZE] __attribute__((aligned(32)));
+
+static spi_ring_t usb_ring = {0, 0, {}, SPI_EVENTS_USB_SIZE - 1, usb_buf};
+static spi_ring_t irq_ring = {0, 0, {}, SPI_EVENTS_IRQ_SIZE - 1, irq_buf};
+
+static_assert((SPI_EVENTS_USB_SIZE & (SPI_EVENTS_USB_SIZE - 1)) == 0, "SPI_EVENTS_USB_SIZE must be a power of 2");
+static_assert((SPI_EVENTS_IRQ_SIZE & (SPI_EVENTS_IRQ_SIZE - 1)) == 0, "SPI_EVENTS_IRQ_SIZE must be a power of 2");
+
+static bool ring_push(spi_ring_t *r, uint8_t cmd, uint8_t addr, uint8_t data, bool can_wait) {
+  uint32_t head = r->head;
+  uint32_t depth = head - r->tail;
+  if (depth > r->mask) {
+    if (!can_wait) {
+      r->stats.dropped++;
+      return false;
+    }
+    r->stats.waited++;
+    uint32_t start = time_us_32();
+    while (head - r->tail > r->mask) {
+      if (time_us_32() - start > SPI_EVENTS_WAIT_US) {
+        r->stats.dropped++;
+        return false;
+      }
+      tight_loop_contents();
+    }
+    depth = head - r->tail;
+  }
+  spi_event_t *e = &r->buf[head & r->mask];
+  e->cmd = cmd;
+  e->addr = addr;
+  e->data = data;
+  e->ts = time_us_32();
+  // slot contents must be visible before the new head
+  __dmb();
+  r->head = head + 1;
+  r->stats.pushed++;
+  if (depth + 1 > r->stats.max_depth) r->stats.max_depth = depth + 1;
+  return true;
+}
+
+// producer side, called from the usb core or from a core0 irq.
+// core0 thread code must not push (it would race the irq producer), it
+// talks to the fpga with spi_send() directly
+bool spi_events_push(uint8_t cmd, uint8_t addr, uint8_t data) {
+  if (get_core_num() == 1) {
+    return ring_push(&usb_ring, cmd, addr, data, true);
+  }
+  return ring_push(&irq_ring, cmd, addr, data, false);
+}
+
+// consumer side (core0 main loop): moves up to max events into buf,
+// oldest first across both rings. returns the number of events
+uint16_t spi_events_drain(spi_event_t *buf, uint16_t max) {
+  uint32_t usb_tail = usb_ring.tail, usb_head = usb_ring.head;
+  uint32_t irq_tail = irq_ring.tail, irq_head = irq_ring.head;
+  // slots up to head are complete
+  __dmb();
+  uint16_t n = 0;
+  while (n < max && (usb_tail != usb_head || irq_tail != irq_head)) {
+    bool from_usb;
+    if (usb_tail == usb_head) {
+      from_usb = false;
+    } else if (irq_tail == irq_head) {
+      from_usb = true;
+    } else {
+      from_usb = (int32_t)(usb_buf[usb_tail & usb_ring.mask].ts - irq_buf[irq_tail & irq_ring.mask].ts) <= 0;
+    }
+    if (from_usb) {
+      buf[n++] = usb_buf[usb_tail++ & usb_ring.mask];
+    } else {
+      buf[n++] = irq_buf[irq_tail++ & irq_ring.mask];
+    }
+  }
+  // slots are copied out before they are handed back
+  __dmb();
+  usb_ring.tail = usb_tail;
+  irq_ring.tail = irq_tail;
+  return n;
+}
+
+// discard everything queued so far (consumer side)
+void spi_events_flush() {
+  spi_event_t buf[SPI_EVENTS_BATCH];
+  while (spi_events_drain(buf, SPI_EVENTS_BATCH) > 0) {}
+}
+
+void spi_events_stats(spi_events_stats_t *usb, spi_events_stats_t *irq) {
+  if (usb) *usb = usb_ring.stats;
+  if (irq) *irq = irq_ring.stats;
+}
+
+void spi_events_dump() {
+  d_println("Event ring      pushed   waited  dropped  max");
+  d_printf("usb         %10lu %8lu %8lu %4u", (unsigned long) usb_ring.stats.pushed, (unsigned long) usb_ring.stats.waited, (unsigned long) usb_ring.stats.dropped, usb_ring.stats.max_depth); d_println();
+  d_printf("irq         %10lu %8lu %8lu %4u", (unsigned long) irq_ring.stats.pushed, (unsigned long) irq_ring.stats.waited, (unsigned long) irq_ring.stats.dropped, irq_ring.stats.max_depth); d_println();
+  d_flush();
+}
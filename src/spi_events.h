@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+#include "types.h"
+
+typedef struct {
+  uint32_t pushed; // events accepted
+  uint32_t waited; // pushes that had to wait for a free slot
+  uint32_t dropped; // events lost because the ring stayed full
+  uint16_t max_depth; // ring high watermark
+} spi_events_stats_t;
+
+bool spi_events_push(uint8_t cmd, uint8_t addr, uint8_t data);
+uint16_t spi_events_drain(spi_event_t *buf, uint16_t max);
+void spi_events_flush();
+void spi_events_stats(spi_events_stats_t *usb, spi_events_stats_t *irq);
+void spi_events_dump();
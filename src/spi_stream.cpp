@@ -0,0 +1,160 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/dma.h"
+#include "hardware/spi.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "config.h"
+#include "types.h"
+#include "main.h"
+#include "spi_stream.h"
+
+// Streaming of large blocks (roms, file loader, ioctl) into the banked
+// address space of the fpga side.
+//
+// The CPU fills a ring of SPI_STREAM_BUFS sector-sized buffers straight from SD
+// (PioSPI moves the sector data by DMA) and hands them over with commit().
+// A DMA channel feeds them to SPI0 TX as CMD_BURST frames, the frame headers and
+// bank switches are written from the DMA completion IRQ, so SD reads overlap
+// the fpga transfers. Cores without burst support get the same command sequence
+// from spi_send_banked() synchronously.
+//
+// Inbound fpga commands are not processed while streaming.
+
+static uint8_t stream_buf[SPI_STREAM_BUFS][SPI_STREAM_BUF_SIZE] __attribute__((aligned(4)));
+static uint16_t stream_len[SPI_STREAM_BUFS];
+
+static volatile uint32_t stream_filled = 0; // buffers committed by the cpu
+static volatile uint32_t stream_sent = 0; // buffers completed by the irq
+static volatile bool stream_running = false; // a frame is in flight
+
+static uint8_t stream_bank_cmd;
+static uint8_t stream_data_cmd;
+static uint32_t stream_addr;
+static uint16_t stream_pos;
+static uint16_t stream_seg_len;
+static bool stream_fallback = true;
+static int stream_dma = -1;
+
+// start next frame of the current buffer (irq context or irqs disabled)
+static void stream_next() {
+  for (;;) {
+    if (stream_sent == stream_filled) {
+      stream_running = false;
+      return;
+    }
+    if (stream_pos < stream_len[stream_sent % SPI_STREAM_BUFS]) break;
+    // buffer is done, give it back to the cpu
+    stream_pos = 0;
+    stream_sent++;
+  }
+
+  uint8_t idx = stream_sent % SPI_STREAM_BUFS;
+
+  if ((stream_addr & 0xFF) == 0) {
+    uint8_t bank[7] = {CMD_BURST, stream_bank_cmd, 0, 2,
+      (uint8_t)((stream_addr & 0x0000FF00) >> 8),
+      (uint8_t)((stream_addr & 0x00FF0000) >> 16),
+      (uint8_t)((stream_addr & 0xFF000000) >> 24)};
+    gpio_put(PIN_MCU_SPI_CS, LOW);
+    spi_write_blocking(spi0, bank, sizeof(bank));
+    gpio_put(PIN_MCU_SPI_CS, HIGH);
+  }
+
+  // up to the end of current bank or buffer
+  uint16_t n = 256 - (stream_addr & 0xFF);
+  if (n > stream_len[idx] - stream_pos) n = stream_len[idx] - stream_pos;
+  stream_seg_len = n;
+
+  uint8_t hdr[4] = {CMD_BURST, stream_data_cmd, (uint8_t)(stream_addr & 0xFF), (uint8_t)(n - 1)};
+  stream_running = true;
+  gpio_put(PIN_MCU_SPI_CS, LOW);
+  spi_write_blocking(spi0, hdr, sizeof(hdr));
+  dma_channel_transfer_from_buffer_now(stream_dma, &stream_buf[idx][stream_pos], n);
+}
+
+static void stream_irq() {
+  if (stream_dma < 0 || !dma_channel_get_irq1_status(stream_dma)) return;
+  dma_channel_acknowledge_irq1(stream_dma);
+
+  // last bytes are still in the SPI FIFO
+  while (spi_is_busy(spi0)) tight_loop_contents();
+  gpio_put(PIN_MCU_SPI_CS, HIGH);
+
+  // drop the bytes received during the payload
+  while (spi_is_readable(spi0)) (void) spi_get_hw(spi0)->dr;
+  spi_get_hw(spi0)->icr = SPI_SSPICR_RORIC_BITS;
+
+  stream_addr += stream_seg_len;
+  stream_pos += stream_seg_len;
+  stream_next();
+}
+
+void spi_stream_begin(uint8_t bank_cmd, uint8_t data_cmd, uint32_t addr) {
+  stream_bank_cmd = bank_cmd;
+  stream_data_cmd = data_cmd;
+  stream_addr = addr;
+  stream_pos = 0;
+  stream_filled = 0;
+  stream_sent = 0;
+  stream_running = false;
+  stream_fallback = !bitRead(core.features, CORE_FEATURE_BURST);
+  if (stream_fallback) return;
+
+  if (stream_dma < 0) {
+    stream_dma = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(stream_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(spi0, true));
+    dma_channel_configure(stream_dma, &c, &spi_get_hw(spi0)->dr, NULL, 0, false);
+    irq_add_shared_handler(DMA_IRQ_1, stream_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+    dma_channel_set_irq1_enabled(stream_dma, true);
+  }
+
+  SPI.beginTransaction(spi_get_settings());
+}
+
+// next free buffer of SPI_STREAM_BUF_SIZE bytes, waits while the ring is full.
+// it stays owned by the cpu until commit()
+uint8_t* spi_stream_acquire() {
+  if (stream_fallback) return stream_buf[0];
+  while (stream_filled - stream_sent >= SPI_STREAM_BUFS) {
+    tight_loop_contents();
+  }
+  return stream_buf[stream_filled % SPI_STREAM_BUFS];
+}
+
+void spi_stream_commit(uint8_t *buf, uint16_t len) {
+  if (len == 0) return;
+  if (stream_fallback) {
+    spi_send_banked(stream_bank_cmd, stream_data_cmd, stream_addr, buf, len);
+    stream_addr += len;
+    return;
+  }
+  stream_len[stream_filled % SPI_STREAM_BUFS] = len;
+  uint32_t irq = save_and_disable_interrupts();
+  stream_filled++;
+  if (!stream_running) stream_next();
+  restore_interrupts(irq);
+}
+
+bool spi_stream_busy() {
+  return stream_sent != stream_filled;
+}
+
+void spi_stream_wait() {
+  while (spi_stream_busy()) {
+    tight_loop_contents();
+  }
+}
+
+void spi_stream_end() {
+  spi_stream_wait();
+  if (!stream_fallback) {
+    SPI.endTransaction();
+  }
+  stream_fallback = true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Arduino.h>
+
+void spi_stream_begin(uint8_t bank_cmd, uint8_t data_cmd, uint32_t addr);
+uint8_t* spi_stream_acquire();
+void spi_stream_commit(uint8_t *buf, uint16_t len);
+bool spi_stream_busy();
+void spi_stream_wait();
+void spi_stream_end();
@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include <ctype.h>
+#include "strutil.h"
+
+// strlcpy: always terminated, returns the length of src
+size_t str_copy(char *dst, size_t size, const char *src) {
+  size_t len = strlen(src);
+  if (size > 0) {
+    size_t n = (len < size) ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+
+// trim whitespace in place
+char* str_trim(char *s) {
+  char *start = s;
+  while (*start && isspace((unsigned char) *start)) start++;
+  size_t len = strlen(start);
+  while (len > 0 && isspace((unsigned char) start[len-1])) len--;
+  if (start != s) memmove(s, start, len);
+  s[len] = '\0';
+  return s;
+}
+
+char* str_lower(char *s) {
+  for (char *p = s; *p; p++) *p = tolower((unsigned char) *p);
+  return s;
+}
+
+bool str_icontains(const char *haystack, const char *needle) {
+  size_t n = strlen(needle);
+  for (const char *p = haystack; *p; p++) {
+    if (strncasecmp(p, needle, n) == 0) return true;
+  }
+  return n == 0;
+}
+
+// normalized working dir: trimmed, absolute, "/" when empty
+void path_dir(char *dst, size_t size, const char *dir) {
+  while (*dir && isspace((unsigned char) *dir)) dir++;
+  if (*dir == '/') {
+    str_copy(dst, size, dir);
+  } else if (size > 1) {
+    dst[0] = '/';
+    str_copy(dst + 1, size - 1, dir);
+  }
+  str_trim(dst);
+}
+
+// dir + "/" + name without doubled slashes, returns the resulting length
+size_t path_join(char *dst, size_t size, const char *dir, const char *name) {
+  size_t len = str_copy(dst, size, dir);
+  if (len >= size) return len;
+  if (len == 0 || dst[len-1] != '/') {
+    if (len + 1 >= size) return len + 1;
+    dst[len++] = '/';
+    dst[len] = '\0';
+  }
+  while (*name == '/') name++;
+  return len + str_copy(dst + len, size - len, name);
+}
+
+// "/a/b" -> "/a", "/a" -> "/"
+char* path_parent(char *dir) {
+  char *slash = strrchr(dir, '/');
+  if (slash == NULL || slash == dir) {
+    strcpy(dir, "/");
+  } else {
+    *slash = '\0';
+  }
+  return dir;
+}
+
+// extension without the dot, "" if there is none
+const char* path_ext(const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (dot == NULL || strchr(dot, '/') != NULL) return "";
+  return dot + 1;
+}
+
+// exts is a free form list like ".trd .scl .fdi", empty matches everything.
+// the last 4 chars of the (8.3) filename are looked up, case insensitive
+bool path_ext_match(const char *exts, const char *filename) {
+  while (*exts && isspace((unsigned char) *exts)) exts++;
+  if (*exts == '\0') return true;
+  size_t len = strlen(filename);
+  return str_icontains(exts, filename + ((len > 4) ? len - 4 : 0));
+}
+
+// fnv-1a, chainable through h
+uint32_t mem_hash(const void *data, size_t len, uint32_t h) {
+  const uint8_t *p = (const uint8_t*) data;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ p[i]) * 16777619UL;
+  }
+  return h;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// fixed buffer string and path helpers, they never touch the heap
+
+size_t str_copy(char *dst, size_t size, const char *src);
+char* str_trim(char *s);
+char* str_lower(char *s);
+bool str_icontains(const char *haystack, const char *needle);
+
+void path_dir(char *dst, size_t size, const char *dir);
+size_t path_join(char *dst, size_t size, const char *dir, const char *name);
+char* path_parent(char *dir);
+const char* path_ext(const char *path);
+bool path_ext_match(const char *exts, const char *filename);
+
+#define MEM_HASH_SEED 2166136261UL
+uint32_t mem_hash(const void *data, size_t len, uint32_t h = MEM_HASH_SEED);
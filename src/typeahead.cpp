@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include "config.h"
+#include "usb_hid_keys.h"
+#include "typeahead.h"
+
+void typeahead_reset(typeahead_t *t) {
+  t->len = 0;
+  t->prefix[0] = '\0';
+}
+
+bool typeahead_active(typeahead_t *t) {
+  if (t->len > 0 && millis() - t->last > TYPEAHEAD_TIMEOUT) {
+    typeahead_reset(t);
+  }
+  return t->len > 0;
+}
+
+// returns true when the prefix has changed and the selection should follow
+bool typeahead_key(typeahead_t *t, uint8_t keycode) {
+  bool active = typeahead_active(t);
+  char c = 0;
+  if (keycode >= KEY_A && keycode <= KEY_Z) {
+    c = 'a' + (keycode - KEY_A);
+  } else if (keycode >= KEY_1 && keycode <= KEY_9) {
+    c = '1' + (keycode - KEY_1);
+  } else if (keycode == KEY_0) {
+    c = '0';
+  } else if (keycode == KEY_SPACE && active) {
+    c = ' ';
+  } else if (keycode == KEY_BACKSPACE && active) {
+    t->prefix[--t->len] = '\0';
+    t->last = millis();
+    return t->len > 0;
+  }
+  if (c == 0 || t->len >= TYPEAHEAD_LEN) {
+    return false;
+  }
+  t->prefix[t->len++] = c;
+  t->prefix[t->len] = '\0';
+  t->last = millis();
+  return true;
+}
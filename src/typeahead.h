@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// type-ahead search prefix for the file loader and core browser lists:
+// letters, digits and (after the first char) space extend it, backspace
+// shortens it, TYPEAHEAD_TIMEOUT ms without a key starts a new one
+
+typedef struct {
+  char prefix[TYPEAHEAD_LEN+1];
+  uint8_t len;
+  uint32_t last; // millis() of the last accepted key
+} typeahead_t;
+
+void typeahead_reset(typeahead_t *t);
+bool typeahead_active(typeahead_t *t);
+bool typeahead_key(typeahead_t *t, uint8_t keycode);
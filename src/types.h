@@ -6,8 +6,9 @@
 typedef struct {
 	uint8_t cmd;
 	uint8_t addr;
-    uint8_t data;
-} queue_spi_t;
+	uint8_t data;
+	uint32_t ts; // time_us_32() at push
+} spi_event_t;
 
 typedef struct {
 	bool flash;
@@ -73,6 +74,7 @@ typedef struct {
 	uint8_t eeprom_bank;
 	uint8_t rtc_type;
 	uint8_t spi_freq;
+	uint8_t features;
 	core_osd_t osd[MAX_OSD_ITEMS];
 	uint8_t osd_len;
 	core_eeprom_t eeprom[MAX_EEPROM_ITEMS];
@@ -90,9 +92,14 @@ typedef struct {
 
 typedef struct {
 	uint16_t file_id;
-	char hash[SORT_HASH_LEN];
+	uint8_t key[SORT_KEY_LEN]; // collation key prefix of the long name
 } file_list_sort_item_t;
 
+typedef struct {
+	uint16_t file_id;
+	uint8_t key[SORT_REC_KEY_LEN]; // longer collation key, while the list is sorted
+} file_sort_rec_t;
+
 typedef struct {
 	bool debug_enabled;
 	bool debug_hid;
@@ -0,0 +1,140 @@
+// Host check of the external merge sort used for large file lists
+// (see src/ext_sort.h, src/file_index.cpp).
+//
+// Sorts generated file names by their collation keys through runs of
+// RUN_RECORDS records (as many sort records as files[] holds on the device) spilled to a temp file
+// and merged step by step into an output file, then checks that the output
+// is complete (every record exactly once) and in order. Short runs force
+// extra merge passes, a shorter output record checks the truncation of the
+// last pass.
+//
+// Build and run from the repository root:
+//   g++ -O2 -I src tools/extsort_check.cpp src/ext_sort.cpp src/collate.cpp -o /tmp/extsort_check && /tmp/extsort_check [count]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "collate.h"
+#include "ext_sort.h"
+
+#define KEY_LEN 62 // SORT_REC_KEY_LEN
+#define LIST_KEY_LEN 4 // SORT_KEY_LEN
+#define RUN_RECORDS 750 // SORT_FILES_MAX list entries over file_sort_rec_t
+
+// same layout as file_sort_rec_t, with a wider id to tell 100k records apart
+struct __attribute__((packed)) item_t {
+  uint32_t id;
+  uint8_t key[KEY_LEN];
+};
+
+static int item_cmp(const void *a, const void *b) {
+  const item_t *x = (const item_t *) a, *y = (const item_t *) b;
+  int c = memcmp(x->key, y->key, KEY_LEN);
+  if (c) return c;
+  return x->id < y->id ? -1 : (x->id > y->id ? 1 : 0);
+}
+
+static bool file_read(void *ctx, uint32_t pos, void *buf, uint32_t len) {
+  FILE *f = (FILE *) ctx;
+  return fseek(f, pos, SEEK_SET) == 0 && fread(buf, 1, len, f) == len;
+}
+
+static bool file_write(void *ctx, uint32_t pos, const void *buf, uint32_t len) {
+  FILE *f = (FILE *) ctx;
+  return fseek(f, pos, SEEK_SET) == 0 && fwrite(buf, 1, len, f) == len;
+}
+
+static void make_key(item_t *it, uint32_t id) {
+  const char *words[] = {"Dizzy", "Elite", "Exolon", "Head over Heels", "Knight Lore", "Manic Miner", "Saboteur", "Tetris"};
+  const char *exts[] = {"tap", "trd", "scl", "tzx"};
+  char name[64];
+  switch (rand() % 3) {
+    case 0: snprintf(name, sizeof(name), "%c%c%c%d.%s", 'A' + rand() % 26, 'a' + rand() % 26, 'A' + rand() % 26, rand() % 10000, exts[rand() % 4]); break;
+    case 1: snprintf(name, sizeof(name), "%s %d.%s", words[rand() % 8], rand() % 2000, exts[rand() % 4]); break;
+    default: snprintf(name, sizeof(name), "%s (part %d).%s", words[rand() % 8], rand() % 12, exts[rand() % 4]); break;
+  }
+  it->id = id;
+  collate_key(it->key, KEY_LEN, name);
+}
+
+static bool check(uint32_t count, uint32_t run_records, uint16_t out_rec) {
+  FILE *tmp = tmpfile(), *tmp2 = tmpfile(), *out = tmpfile();
+  if (!tmp || !tmp2 || !out) {
+    printf("%u: unable to create temp files\n", count);
+    return false;
+  }
+  ext_sort_file_t tmp_io = {tmp, file_read, file_write};
+  ext_sort_file_t tmp2_io = {tmp2, file_read, file_write};
+  ext_sort_file_t out_io = {out, file_read, file_write};
+
+  // the reference keeps every record, the sort only has the one run buffer
+  std::vector<item_t> ref(count);
+  static item_t buf[RUN_RECORDS];
+  ext_sort_t sort;
+  ext_sort_begin(&sort, buf, run_records * sizeof(item_t), sizeof(item_t), item_cmp, &tmp_io, &tmp2_io);
+
+  srand(count);
+  uint32_t fill = 0;
+  bool ok = true;
+  for (uint32_t i=0; i<count && ok; i++) {
+    make_key(&buf[fill], i);
+    ref[i] = buf[fill];
+    if (++fill == run_records) {
+      std::sort(buf, buf + fill, [](const item_t &a, const item_t &b) { return item_cmp(&a, &b) < 0; });
+      ok = ext_sort_spill(&sort, fill);
+      fill = 0;
+    }
+  }
+  std::sort(buf, buf + fill, [](const item_t &a, const item_t &b) { return item_cmp(&a, &b) < 0; });
+  ok = ok && ext_sort_spill(&sort, fill);
+  // one output segment per step, as the device does it between main loop passes
+  uint32_t steps = 0;
+  ok = ok && ext_sort_merge_begin(&sort, &out_io, 0, out_rec);
+  while (ok && !sort.done) {
+    ok = ext_sort_merge_step(&sort);
+    steps++;
+  }
+  if (!ok) {
+    printf("%u: spill / merge failed (%u runs)\n", count, ext_sort_runs(&sort));
+    return false;
+  }
+
+  // completeness: every id exactly once with its own key; order: non-decreasing
+  uint16_t key_len = out_rec - sizeof(uint32_t);
+  std::vector<uint8_t> seen(count, 0);
+  item_t prev, it;
+  uint32_t n = 0, unsorted = 0, bad = 0;
+  fseek(out, 0, SEEK_SET);
+  while (fread(&it, out_rec, 1, out) == 1) {
+    if (it.id >= count || seen[it.id]++ || memcmp(it.key, ref[it.id].key, key_len) != 0) bad++;
+    if (n > 0 && memcmp(prev.key, it.key, key_len) > 0) unsorted++;
+    prev = it;
+    n++;
+  }
+  fclose(tmp);
+  fclose(tmp2);
+  fclose(out);
+  ok = n == count && bad == 0 && unsorted == 0;
+  printf("%7u records, %4u runs of %4u, %2u byte output, %6u steps: %s (%u read, %u bad, %u out of order)\n",
+    count, ext_sort_runs(&sort), run_records, out_rec, steps, ok ? "ok" : "FAILED", n, bad, unsorted);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  bool ok = true;
+  if (argc > 1) {
+    ok = check(strtoul(argv[1], nullptr, 10), RUN_RECORDS, sizeof(item_t));
+  } else {
+    // empty, single run, run boundaries, one and more than EXT_SORT_FAN_IN
+    // runs (two merge passes for the device maximum, three for 100k)
+    uint32_t counts[] = {0, 1, RUN_RECORDS - 1, RUN_RECORDS, RUN_RECORDS + 1,
+      EXT_SORT_FAN_IN * RUN_RECORDS, EXT_SORT_FAN_IN * RUN_RECORDS + 1, 65535};
+    for (uint32_t c : counts) ok = check(c, RUN_RECORDS, sizeof(item_t)) && ok;
+    ok = check(100000, 300, sizeof(item_t)) && ok;
+    // only the id and the list key prefix reach the index
+    ok = check(65535, RUN_RECORDS, sizeof(uint32_t) + LIST_KEY_LEN) && ok;
+  }
+  return ok ? 0 : 1;
+}
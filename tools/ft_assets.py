@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# version 2 as published by the Free Software Foundation.
+#
+# FT812 asset packer.
+#
+# Reads the raw u-law key sound arrays from src/bitmaps.h and writes
+# src/bitmaps_z.h with their zlib (deflate) compressed copies, which the
+# firmware uploads with the FT812 CMD_INFLATE co-processor command.
+# The logo and background arrays are PNG files, deflate compressed already,
+# so they are left as they are.
+#
+# Usage:
+#   ft_assets.py build src/bitmaps.h src/bitmaps_z.h
+#   ft_assets.py verify src/bitmaps.h src/bitmaps_z.h
+#
+
+import argparse
+import re
+import sys
+import zlib
+
+ASSETS = ["key1", "key2", "key3", "key4"]
+
+ARRAY_RE = re.compile(r"static const uint8_t (\w+)Data\[\]\s*=\s*\{(.*?)\};", re.S)
+DEFINE_RE = re.compile(r"#define (\w+) (\d+)")
+
+
+def parse_arrays(text):
+    res = {}
+    for name, body in ARRAY_RE.findall(text):
+        res[name] = bytes(int(v, 0) for v in body.replace("\n", " ").split(",") if v.strip())
+    return res
+
+
+def parse_defines(text):
+    return {k: int(v) for k, v in DEFINE_RE.findall(text)}
+
+
+def c_array(name, data):
+    lines = ["static const uint8_t %s[] = {" % name]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def build(raw):
+    out = [
+        "// generated by tools/ft_assets.py from bitmaps.h, do not edit",
+        "// zlib compressed key sounds, uploaded by CMD_INFLATE",
+        "",
+        "#pragma once",
+        "",
+    ]
+    for name in ASSETS:
+        data = raw[name]
+        packed = zlib.compress(data, 9)
+        assert zlib.decompress(packed) == data
+        print("%s: %d -> %d" % (name, len(data), len(packed)))
+        up = name.upper()
+        out.append("#define %s_ZRAW %d // must match %s_SIZE" % (up, len(data), up))
+        out.append("#define %s_ZSIZE %d" % (up, len(packed)))
+        out.append(c_array(name + "ZData", packed))
+        out.append("")
+    return "\n".join(out)
+
+
+def verify(raw, text):
+    packed = parse_arrays(text)
+    defines = parse_defines(text)
+    ok = True
+    for name in ASSETS:
+        up = name.upper()
+        z = packed.get(name + "Z")
+        if z is None:
+            print("%s: missing" % name)
+            ok = False
+            continue
+        if len(z) != defines.get(up + "_ZSIZE") or len(raw[name]) != defines.get(up + "_ZRAW"):
+            print("%s: size mismatch" % name)
+            ok = False
+            continue
+        if zlib.decompress(z) != raw[name]:
+            print("%s: content mismatch" % name)
+            ok = False
+            continue
+        print("%s: ok (%d -> %d)" % (name, len(raw[name]), len(z)))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FT812 asset packer")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    b = sub.add_parser("build", help="write the compressed assets header")
+    b.add_argument("input")
+    b.add_argument("output")
+    v = sub.add_parser("verify", help="check the compressed assets header against the raw arrays")
+    v.add_argument("input")
+    v.add_argument("output")
+    args = parser.parse_args()
+
+    with open(args.input) as f:
+        raw = parse_arrays(f.read())
+    for name in ASSETS:
+        if name not in raw:
+            print("%s: not found in %s" % (name, args.input))
+            return 1
+
+    if args.cmd == "build":
+        with open(args.output, "w") as f:
+            f.write(build(raw))
+        return 0
+
+    with open(args.output) as f:
+        text = f.read()
+    if not verify(raw, text):
+        print("%s is stale, run: ft_assets.py build %s %s" % (args.output, args.input, args.output))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
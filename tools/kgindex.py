@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# version 2 as published by the Free Software Foundation.
+#
+# Karabas Go file list index tool (/.kgcache/<hash>.idx, see src/file_index.cpp).
+#
+# The firmware stores one index per directory and extension filter with the
+# (dirIndex, collation key prefix) records of the file loader list, in the
+# order of the whole collated long names.
+# dirIndex values are FAT directory slots and can only be checked for
+# uniqueness on the host, the rest is checked against the directory tree:
+# record count, collation keys of the long names and sort order (as far as
+# the key prefixes tell it).
+# Generated trees use 8.3 extensions, so the extension filter (which the
+# firmware applies to the short names) gives the same result on the host.
+#
+# Usage:
+#   kgindex.py gen [--count N] [--seed S] dir
+#   kgindex.py dump file.idx
+#   kgindex.py verify --ext ".tap .trd" file.idx dir
+#   kgindex.py name --ext ".tap .trd" /dir
+#
+
+import argparse
+import os
+import random
+import string
+import struct
+import sys
+
+MAGIC = b"KGIX"
+VERSION = 4
+HEADER = struct.Struct("<4sBBHIIII")
+INDEX_DIR = "/.kgcache"
+
+FNV_SEED = 2166136261
+FNV_PRIME = 16777619
+
+
+def mem_hash(data, h=FNV_SEED):
+    for b in data:
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def index_name(dir_path, exts):
+    key = mem_hash(dir_path.encode() + b"|" + exts.encode())
+    return "%s/%08x.idx" % (INDEX_DIR, key)
+
+
+def ext_match(exts, filename):
+    # same rules as path_ext_match(): last 4 chars, case-insensitive substring
+    if not exts.strip():
+        return True
+    return filename[-4:].lower() in exts.lower()
+
+
+def collate_key(name, key_len):
+    # same as collate_key() in src/collate.cpp
+    key = bytearray()
+    p = name.encode("utf-8", "replace")
+    i = 0
+    while i < len(p) and len(key) < key_len:
+        c = p[i]
+        if 0x30 <= c <= 0x39:
+            while p[i] == 0x30 and i + 1 < len(p) and 0x30 <= p[i + 1] <= 0x39:
+                i += 1
+            e = i
+            while e < len(p) and 0x30 <= p[e] <= 0x39:
+                e += 1
+            key.append(0x30 + min(e - i, 9))
+            key += p[i:e][:key_len - len(key)]
+            i = e
+        else:
+            key.append(c + 0x20 if 0x41 <= c <= 0x5A else c)
+            i += 1
+    return bytes(key).ljust(key_len, b"\0")
+
+
+def collate_name(name):
+    # the whole key, as collate_cmp() compares the names
+    return collate_key(name, 4 * len(name)).rstrip(b"\0")
+
+
+def read_index(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        raise ValueError("truncated header")
+    magic, version, key_len, count, entries, fingerprint, ext_hash, crc = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("bad magic %r" % magic)
+    if version != VERSION:
+        raise ValueError("unsupported version %d" % version)
+    rec = 2 + key_len
+    body = data[HEADER.size:]
+    if len(body) != count * rec:
+        raise ValueError("expected %d records, got %d bytes" % (count, len(body)))
+    if mem_hash(body) != crc:
+        raise ValueError("record crc mismatch")
+    records = []
+    for i in range(count):
+        file_id, = struct.unpack_from("<H", body, i * rec)
+        records.append((file_id, body[i * rec + 2:(i + 1) * rec]))
+    hdr = dict(key_len=key_len, count=count, entries=entries, fingerprint=fingerprint, ext_hash=ext_hash)
+    return hdr, records
+
+
+def gen(path, count, seed):
+    rnd = random.Random(seed)
+    os.makedirs(path, exist_ok=True)
+    exts = ["TAP", "TRD", "SCL", "TXT"]
+    words = ["Dizzy", "Elite", "Exolon", "Head over Heels", "Knight Lore", "Manic Miner", "Saboteur"]
+    names = set()
+    while len(names) < count:
+        kind = rnd.randint(0, 2)
+        if kind == 0:
+            # 8.3 names
+            base = "".join(rnd.choice(string.ascii_uppercase + string.digits) for _ in range(rnd.randint(1, 8)))
+        elif kind == 1:
+            # long names sharing a prefix, numbered without padding
+            base = "%s %d" % (rnd.choice(words), rnd.randint(0, 120))
+        else:
+            base = "%s (%s)" % (rnd.choice(words), rnd.choice(["side A", "side B", "1987", "128k"]))
+        names.add("%s.%s" % (base, rnd.choice(exts)))
+    for name in sorted(names):
+        with open(os.path.join(path, name), "wb") as f:
+            f.write(bytes(rnd.getrandbits(8) for _ in range(rnd.randint(0, 64))))
+    for i in range(3):
+        os.makedirs(os.path.join(path, "DIR%d" % i), exist_ok=True)
+    print("%s: %d files" % (path, len(names)))
+
+
+def verify(idx_path, tree, exts):
+    hdr, records = read_index(idx_path)
+    ok = True
+    key_len = hdr["key_len"]
+
+    if hdr["ext_hash"] != mem_hash(exts.encode()):
+        print("ext_hash mismatch, index was built for another filter")
+        ok = False
+
+    files = [n for n in os.listdir(tree) if os.path.isfile(os.path.join(tree, n)) and ext_match(exts, n)]
+    expected = sorted(collate_key(n, key_len) for n in files)
+    got = sorted(k for _, k in records)
+    if got != expected:
+        print("records do not match the tree: %d in index, %d files" % (len(got), len(expected)))
+        ok = False
+
+    ids = [i for i, _ in records]
+    if len(set(ids)) != len(ids):
+        print("duplicate file ids")
+        ok = False
+
+    if [k for _, k in records] != [collate_key(n, key_len) for n in sorted(files, key=collate_name)]:
+        print("records are not sorted")
+        ok = False
+
+    if hdr["entries"] < len(files):
+        print("entry count %d is below the file count %d" % (hdr["entries"], len(files)))
+        ok = False
+
+    print("%s: %s (%d records)" % (idx_path, "ok" if ok else "FAILED", len(records)))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Karabas Go file list index tool")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    g = sub.add_parser("gen", help="generate a test directory tree")
+    g.add_argument("--count", type=int, default=500)
+    g.add_argument("--seed", type=int, default=1)
+    g.add_argument("dir")
+    d = sub.add_parser("dump", help="print an index")
+    d.add_argument("index")
+    v = sub.add_parser("verify", help="check an index against a directory tree")
+    v.add_argument("--ext", default="", help="core file extensions filter")
+    v.add_argument("index")
+    v.add_argument("dir")
+    n = sub.add_parser("name", help="print the index file name of a directory")
+    n.add_argument("--ext", default="", help="core file extensions filter")
+    n.add_argument("dir", help="absolute directory path on the sd card")
+    args = parser.parse_args()
+
+    try:
+        if args.cmd == "gen":
+            gen(args.dir, args.count, args.seed)
+        elif args.cmd == "name":
+            print(index_name(args.dir, args.ext))
+        elif args.cmd == "dump":
+            hdr, records = read_index(args.index)
+            print(" ".join("%s=%s" % (k, ("%08x" % v) if k in ("fingerprint", "ext_hash") else v) for k, v in hdr.items()))
+            for file_id, k in records:
+                print("%5d %s" % (file_id, k.hex()))
+        else:
+            return 0 if verify(args.index, args.dir, args.ext) else 1
+    except (OSError, ValueError) as e:
+        print("error: %s" % e)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# version 2 as published by the Free Software Foundation.
+#
+# Karabas Go .kg container packer.
+#
+# Compresses the bitstream and/or the internal ROM sections of a .kg file
+# with the LZSS flavour understood by lib/Lzss, updates the stored lengths
+# and sets the compression flags at FILE_POS_COMPRESSION.
+#
+# External ROM descriptors (len bit 31 set) carry a NUL padded path instead
+# of data, relative to the .kg file unless it starts with '/'.
+#
+# Usage:
+#   kgpack.py pack [--no-bitstream] [--no-roms] in.kg1 out.kg1
+#   kgpack.py unpack in.kg1 out.kg1
+#   kgpack.py extrom --addr ADDR in.kg1 out.kg1 path/to/rom.bin
+#
+
+import argparse
+import struct
+import sys
+
+FILE_POS_BITSTREAM_LEN = 80
+FILE_POS_ROM_LEN = 84
+FILE_POS_COMPRESSION = 186
+FILE_POS_BITSTREAM_START = 1024
+
+COMPRESSION_BITSTREAM = 0x01
+COMPRESSION_ROMS = 0x02
+
+ROM_EXTERNAL = 0x80000000
+
+WINDOW_SIZE = 4096
+MIN_MATCH = 3
+MAX_MATCH = 18
+MAX_CHAIN = 64
+
+
+def lzss_encode(data):
+    out = bytearray()
+    chains = {}
+    pos = 0
+    n = len(data)
+    flag_pos = -1
+    flag_bit = 8
+
+    while pos < n:
+        if flag_bit == 8:
+            flag_pos = len(out)
+            out.append(0)
+            flag_bit = 0
+
+        best_len = 0
+        best_dist = 0
+        if pos + MIN_MATCH <= n:
+            key = bytes(data[pos:pos + MIN_MATCH])
+            cand = chains.get(key)
+            if cand:
+                max_len = min(MAX_MATCH, n - pos)
+                for p in reversed(cand[-MAX_CHAIN:]):
+                    dist = pos - p
+                    if dist > WINDOW_SIZE:
+                        break
+                    l = MIN_MATCH
+                    while l < max_len and data[p + l] == data[pos + l]:
+                        l += 1
+                    if l > best_len:
+                        best_len = l
+                        best_dist = dist
+                        if l == max_len:
+                            break
+
+        if best_len >= MIN_MATCH:
+            d = best_dist - 1
+            out.append(d >> 4)
+            out.append(((d & 0x0F) << 4) | (best_len - MIN_MATCH))
+            step = best_len
+        else:
+            out[flag_pos] |= 1 << flag_bit
+            out.append(data[pos])
+            step = 1
+        flag_bit += 1
+
+        for i in range(pos, min(pos + step, n - MIN_MATCH + 1)):
+            chains.setdefault(bytes(data[i:i + MIN_MATCH]), []).append(i)
+        pos += step
+
+    return bytes(out)
+
+
+def lzss_decode(data):
+    out = bytearray()
+    pos = 0
+    n = len(data)
+    while pos < n:
+        flags = data[pos]
+        pos += 1
+        for bit in range(8):
+            if pos >= n:
+                break
+            if flags & (1 << bit):
+                out.append(data[pos])
+                pos += 1
+            else:
+                if pos + 1 >= n:
+                    raise ValueError("truncated match token")
+                hi, lo = data[pos], data[pos + 1]
+                pos += 2
+                dist = ((hi << 4) | (lo >> 4)) + 1
+                length = (lo & 0x0F) + MIN_MATCH
+                if dist > len(out):
+                    raise ValueError("match distance out of range")
+                for _ in range(length):
+                    out.append(out[-dist])
+    return bytes(out)
+
+
+def rd32(buf, pos):
+    return struct.unpack(">I", buf[pos:pos + 4])[0]
+
+
+def split(kg):
+    header = bytearray(kg[:FILE_POS_BITSTREAM_START])
+    bitstream_len = rd32(kg, FILE_POS_BITSTREAM_LEN)
+    roms_len = rd32(kg, FILE_POS_ROM_LEN)
+    bitstream = kg[FILE_POS_BITSTREAM_START:FILE_POS_BITSTREAM_START + bitstream_len]
+    pos = FILE_POS_BITSTREAM_START + bitstream_len
+    roms_end = pos + roms_len
+    roms = []
+    while pos < roms_end:
+        rom_len = rd32(kg, pos)
+        rom_addr = rd32(kg, pos + 4)
+        size = rom_len & ~ROM_EXTERNAL
+        roms.append((rom_len & ROM_EXTERNAL, rom_addr, kg[pos + 8:pos + 8 + size]))
+        pos += 8 + size
+    tail = kg[roms_end:]
+    return header, bitstream, roms, tail
+
+
+def join(header, bitstream, roms, tail):
+    rom_data = bytearray()
+    for ext, addr, data in roms:
+        rom_data += struct.pack(">II", len(data) | ext, addr) + data
+    header[FILE_POS_BITSTREAM_LEN:FILE_POS_BITSTREAM_LEN + 4] = struct.pack(">I", len(bitstream))
+    header[FILE_POS_ROM_LEN:FILE_POS_ROM_LEN + 4] = struct.pack(">I", len(rom_data))
+    return bytes(header) + bitstream + bytes(rom_data) + tail
+
+
+def pack(kg, do_bitstream, do_roms):
+    header, bitstream, roms, tail = split(kg)
+    flags = header[FILE_POS_COMPRESSION]
+    if flags:
+        raise ValueError("container is already packed (flags %02x)" % flags)
+    if do_bitstream:
+        packed = lzss_encode(bitstream)
+        assert lzss_decode(packed) == bitstream
+        print("bitstream: %d -> %d" % (len(bitstream), len(packed)))
+        bitstream = packed
+        flags |= COMPRESSION_BITSTREAM
+    if do_roms and roms:
+        packed_roms = []
+        for i, (ext, addr, data) in enumerate(roms):
+            # external rom descriptors carry a path, not data
+            if not ext:
+                packed = lzss_encode(data)
+                assert lzss_decode(packed) == data
+                print("rom #%d: %d -> %d" % (i, len(data), len(packed)))
+                data = packed
+            packed_roms.append((ext, addr, data))
+        roms = packed_roms
+        flags |= COMPRESSION_ROMS
+    header[FILE_POS_COMPRESSION] = flags
+    return join(header, bitstream, roms, tail)
+
+
+def unpack(kg):
+    header, bitstream, roms, tail = split(kg)
+    flags = header[FILE_POS_COMPRESSION]
+    if flags & COMPRESSION_BITSTREAM:
+        bitstream = lzss_decode(bitstream)
+    if flags & COMPRESSION_ROMS:
+        roms = [(ext, addr, data if ext else lzss_decode(data)) for ext, addr, data in roms]
+    header[FILE_POS_COMPRESSION] = 0
+    return join(header, bitstream, roms, tail)
+
+
+def extrom(kg, addr, path):
+    header, bitstream, roms, tail = split(kg)
+    data = path.encode("ascii") + b"\0"
+    if len(data) > 255:
+        raise ValueError("rom path is too long")
+    # pad to 4 bytes to keep the following descriptors word aligned
+    data += b"\0" * (-len(data) % 4)
+    roms.append((ROM_EXTERNAL, addr, data))
+    return join(header, bitstream, roms, tail)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Karabas Go .kg container packer")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("pack", help="compress bitstream and rom sections")
+    p.add_argument("--no-bitstream", action="store_true", help="keep the bitstream raw")
+    p.add_argument("--no-roms", action="store_true", help="keep the roms raw")
+    p.add_argument("input")
+    p.add_argument("output")
+    u = sub.add_parser("unpack", help="restore a raw container")
+    u.add_argument("input")
+    u.add_argument("output")
+    e = sub.add_parser("extrom", help="append an external rom descriptor")
+    e.add_argument("--addr", required=True, type=lambda v: int(v, 0), help="rom load address")
+    e.add_argument("input")
+    e.add_argument("output")
+    e.add_argument("path")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        kg = f.read()
+
+    if args.cmd == "pack":
+        res = pack(kg, not args.no_bitstream, not args.no_roms)
+    elif args.cmd == "extrom":
+        res = extrom(kg, args.addr, args.path)
+    else:
+        res = unpack(kg)
+
+    with open(args.output, "wb") as f:
+        f.write(res)
+    print("%s: %d -> %d bytes" % (args.output, len(kg), len(res)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
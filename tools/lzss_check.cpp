@@ -0,0 +1,92 @@
+// Host check of the lib/Lzss streaming decoder, driven by tools/lzss_check.py
+// with streams packed by kgpack.py.
+//
+// Decodes packed into raw with random input and output chunk sizes, and the
+// truncated streams given as cut:idle pairs (packed length, expected idle()),
+// which must decode to a strict prefix of raw.
+//
+//   g++ -O2 -I lib/Lzss tools/lzss_check.cpp lib/Lzss/Lzss.cpp -o /tmp/lzss_check
+//   lzss_check packed.bin raw.bin [cut:idle ...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Lzss.h"
+
+#define SPLITS 200
+
+static std::vector<uint8_t> read_file(const char *path) {
+  std::vector<uint8_t> d;
+  FILE *f = fopen(path, "rb");
+  if (!f) return d;
+  int c;
+  while ((c = fgetc(f)) != EOF) d.push_back(c);
+  fclose(f);
+  return d;
+}
+
+static size_t chunk(size_t max) {
+  // mostly tiny chunks to split tokens, sometimes large ones
+  return rand() % 4 ? 1 + rand() % 3 : 1 + rand() % max;
+}
+
+// decodes in[0..in_len) with random chunking, returns the output
+static std::vector<uint8_t> decode(Lzss *lz, const uint8_t *in, size_t in_len, size_t max_out) {
+  std::vector<uint8_t> out(max_out + 64);
+  size_t in_pos = 0, out_pos = 0;
+  lz->reset();
+  for (;;) {
+    size_t in_n = in_len - in_pos;
+    size_t c = chunk(4096);
+    if (in_n > c) in_n = c;
+    size_t out_n = out.size() - out_pos;
+    c = chunk(4096);
+    if (out_n > c) out_n = c;
+    size_t used = 0;
+    size_t n = lz->decode(in + in_pos, in_n, &used, out.data() + out_pos, out_n);
+    in_pos += used;
+    out_pos += n;
+    if (in_pos == in_len && n == 0 && out_pos < out.size()) {
+      // no input left and room for output: nothing more comes out
+      if (lz->decode(in + in_pos, 0, &used, out.data() + out_pos, out.size() - out_pos) == 0) break;
+    }
+    if (out_pos == out.size()) break;
+  }
+  out.resize(out_pos);
+  return out;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printf("usage: %s packed.bin raw.bin [cut:idle ...]\n", argv[0]);
+    return 2;
+  }
+  std::vector<uint8_t> packed = read_file(argv[1]), raw = read_file(argv[2]);
+  static Lzss lz;
+  bool ok = true;
+
+  srand(packed.size());
+  for (int i=0; i<SPLITS && ok; i++) {
+    std::vector<uint8_t> out = decode(&lz, packed.data(), packed.size(), raw.size());
+    if (out != raw || !lz.idle()) {
+      printf("round trip %d: %zu of %zu bytes, %s\n", i, out.size(), raw.size(), lz.idle() ? "idle" : "not idle");
+      ok = false;
+    }
+  }
+
+  for (int a=3; a<argc && ok; a++) {
+    size_t cut = strtoul(argv[a], nullptr, 10);
+    const char *colon = strchr(argv[a], ':');
+    bool expect_idle = colon && colon[1] == '1';
+    std::vector<uint8_t> out = decode(&lz, packed.data(), cut, raw.size());
+    bool prefix = out.size() < raw.size() && memcmp(out.data(), raw.data(), out.size()) == 0;
+    if (!prefix || lz.idle() != expect_idle) {
+      printf("truncated at %zu: %zu bytes, %s, %s\n", cut, out.size(), prefix ? "prefix" : "NOT a prefix", lz.idle() ? "idle" : "not idle");
+      ok = false;
+    }
+  }
+
+  printf("%s: %zu -> %zu bytes, %d splits, %d cuts: %s\n", argv[1], packed.size(), raw.size(), SPLITS, argc - 3, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
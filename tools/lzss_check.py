@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2025 Andy Karpov <andy.karpov@gmail.com>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# version 2 as published by the Free Software Foundation.
+#
+# Host test of the lib/Lzss decoder against the kgpack.py encoder.
+#
+# Packs generated data with kgpack.lzss_encode() and runs tools/lzss_check.cpp
+# on it: round trips with random input / output chunk sizes, and truncated
+# streams cut inside and between tokens. The data covers literals, matches
+# of the maximum length and distance, and several window wraps.
+#
+# Usage:
+#   g++ -O2 -I lib/Lzss tools/lzss_check.cpp lib/Lzss/Lzss.cpp -o /tmp/lzss_check
+#   lzss_check.py /tmp/lzss_check
+#
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from kgpack import lzss_encode, lzss_decode, WINDOW_SIZE, MIN_MATCH, MAX_MATCH
+
+
+def tokens(packed):
+    # yields (start, end, dist, length) of every item, dist 0 for literals
+    pos = 0
+    while pos < len(packed):
+        flags = packed[pos]
+        pos += 1
+        for bit in range(8):
+            if pos >= len(packed):
+                return
+            if flags & (1 << bit):
+                yield pos, pos + 1, 0, 1
+                pos += 1
+            else:
+                hi, lo = packed[pos], packed[pos + 1]
+                yield pos, pos + 2, ((hi << 4) | (lo >> 4)) + 1, (lo & 0x0F) + MIN_MATCH
+                pos += 2
+
+
+def cases():
+    rnd = random.Random(1)
+    block = bytes(rnd.getrandbits(8) for _ in range(WINDOW_SIZE))
+    yield "empty", b""
+    yield "random", bytes(rnd.getrandbits(8) for _ in range(3000))
+    yield "runs", b"".join(bytes([rnd.getrandbits(8)]) * rnd.randint(1, 100) for _ in range(400))
+    # a random block repeated: matches at exactly the window size, wrapping it
+    yield "window", block * 5
+    # text like data with near and far repeats
+    words = [bytes(rnd.choice(b"abcdefgh") for _ in range(rnd.randint(2, 12))) for _ in range(50)]
+    yield "text", b" ".join(rnd.choice(words) for _ in range(4000))
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: lzss_check.py path/to/lzss_check")
+        return 2
+    checker = sys.argv[1]
+    ok = True
+    seen_max_len = seen_max_dist = False
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, raw in cases():
+            packed = lzss_encode(raw)
+            assert lzss_decode(packed) == raw
+            items = list(tokens(packed))
+            seen_max_len |= any(l == MAX_MATCH for _, _, d, l in items if d)
+            seen_max_dist |= any(d == WINDOW_SIZE for _, _, d, _ in items)
+
+            # cuts after a match high byte (not idle) and right after a match
+            # (idle once copied), each drops at least one item of output
+            cuts = []
+            matches = [t for t in items if t[2]]
+            for start, end, _, _ in matches[:: max(1, len(matches) // 8)]:
+                cuts.append("%d:0" % (start + 1))
+                cuts.append("%d:1" % end)
+            cuts = [c for c in cuts if int(c.split(":")[0]) < len(packed)]
+
+            p = os.path.join(tmp, name + ".lzss")
+            r = os.path.join(tmp, name + ".raw")
+            with open(p, "wb") as f:
+                f.write(packed)
+            with open(r, "wb") as f:
+                f.write(raw)
+            res = subprocess.run([checker, p, r] + cuts)
+            ok = ok and res.returncode == 0
+
+    if not (seen_max_len and seen_max_dist):
+        print("test data does not cover max length / max distance matches")
+        ok = False
+    print("ok" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,234 @@
+// Host benchmark of the file loader sort (see src/sorts.h, src/collate.h).
+//
+// Sorts 8000 generated file names three ways and reports the time and how
+// many neighbours end up out of natural order:
+//   string - the old comparator: two lower-cased heap strings of the 4 char
+//            short name prefix per comparison
+//   hash4  - strncasecmp() over the 4 char short name prefix
+//   key    - the file list sort: collate_key() of the long name into a
+//            SORT_KEY_LEN byte list entry key, memcmp() over it, then
+//            collate_sort_ties() on the ties with no scratch, as for a full
+//            list (key building included); name reads are the long names it
+//            reads back per sort, that is directory entries opened on the card
+//
+// Then types the first 1..TYPEAHEAD_LEN chars of names into collate_find()
+// over the sorted list, as the type-ahead search does, checks each result
+// against a scan of the whole names and reports the names read per keypress.
+//
+// Exits with an error unless the key sort leaves no neighbours out of order.
+//
+// Build and run from the repository root:
+//   g++ -O2 -I src tools/sortbench.cpp src/collate.cpp -o /tmp/sortbench && /tmp/sortbench
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+#include <vector>
+#include "collate.h"
+
+#define COUNT 8000
+#define HASH_LEN 4
+#define KEY_LEN 4 // SORT_KEY_LEN
+#define RUNS 20
+#define TYPED 500 // names typed into the type-ahead search
+#define TYPEAHEAD_LEN 16 // chars of a typed prefix
+
+struct hash_item_t {
+  uint16_t file_id;
+  char hash[HASH_LEN];
+};
+
+struct key_item_t {
+  uint16_t file_id;
+  uint8_t key[KEY_LEN];
+};
+
+static std::vector<std::string> names;
+static long name_reads;
+
+static void bench_name(void *ctx, uint16_t id, char *name) {
+  name_reads++;
+  snprintf(name, COLLATE_NAME_MAX, "%s", names[id].c_str());
+}
+
+// roughly what FAT makes of a long name: upper case, 6 chars and ~N
+static std::string short_name(const std::string &name, int n) {
+  std::string base, ext;
+  size_t dot = name.rfind('.');
+  std::string stem = name.substr(0, dot);
+  for (char c : stem) if (c != ' ' && c != '(' && c != ')') base += toupper(c);
+  for (char c : name.substr(dot + 1)) ext += toupper(c);
+  if (base.size() > 8 || stem.size() != base.size()) base = base.substr(0, 6) + "~" + std::to_string(n % 9 + 1);
+  return base + "." + ext;
+}
+
+// reference order: case-insensitive, digit runs by value, over the full name
+static bool natural_less(const std::string &a, const std::string &b) {
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (isdigit(a[i]) && isdigit(b[j])) {
+      size_t ie = i, je = j;
+      while (ie < a.size() && isdigit(a[ie])) ie++;
+      while (je < b.size() && isdigit(b[je])) je++;
+      unsigned long va = strtoul(a.substr(i, ie - i).c_str(), nullptr, 10);
+      unsigned long vb = strtoul(b.substr(j, je - j).c_str(), nullptr, 10);
+      if (va != vb) return va < vb;
+      i = ie; j = je;
+    } else {
+      int ca = tolower(a[i]), cb = tolower(b[j]);
+      if (ca != cb) return ca < cb;
+      i++; j++;
+    }
+  }
+  return a.size() - i < b.size() - j;
+}
+
+static int disorder(const std::vector<uint16_t> &ids) {
+  int n = 0;
+  for (size_t i = 1; i < ids.size(); i++) {
+    if (natural_less(names[ids[i]], names[ids[i - 1]])) n++;
+  }
+  return n;
+}
+
+static double now_ms() {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<key_item_t> sorted;
+
+static void bench_seek(void *ctx, const uint8_t *key, size_t n, size_t *pos, uint8_t *found) {
+  *pos = collate_lower_bound(sorted.data(), sorted.size(), sizeof(key_item_t), key, n, found, bench_name, nullptr);
+}
+
+// what collate_find() should return, from the whole keys of the sorted list
+static size_t find_scan(const std::vector<std::vector<uint8_t>> &keys, const char *prefix) {
+  uint8_t key[COLLATE_PREFIX_MAX];
+  size_t at;
+  size_t n = collate_prefix_key(key, sizeof(key), prefix, &at);
+  uint8_t first = at != (size_t) -1 ? key[at] : 0, last = at != (size_t) -1 ? '9' : 0;
+  for (uint8_t l = first; l <= last; l++) {
+    if (at != (size_t) -1) key[at] = l;
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (memcmp(keys[i].data(), key, n) == 0) return i;
+    }
+  }
+  if (at != (size_t) -1) key[at] = first;
+  size_t i = 0;
+  while (i < keys.size() && memcmp(keys[i].data(), key, n) < 0) i++;
+  return i;
+}
+
+int main() {
+  const char *words[] = {"Dizzy", "Elite", "Exolon", "Head over Heels", "Knight Lore", "Manic Miner", "Saboteur", "Tetris"};
+  const char *exts[] = {"tap", "trd", "scl", "tzx"};
+  srand(1);
+  while (names.size() < COUNT) {
+    char b[128];
+    int kind = rand() % 4;
+    if (kind == 0) {
+      snprintf(b, sizeof(b), "%c%c%c%d.%s", 'A' + rand() % 26, 'A' + rand() % 26, 'A' + rand() % 26, rand() % 1000, exts[rand() % 4]);
+    } else if (kind == 1) {
+      snprintf(b, sizeof(b), "%s %d.%s", words[rand() % 8], rand() % 200, exts[rand() % 4]);
+    } else if (kind == 2) {
+      snprintf(b, sizeof(b), "%s (part %d).%s", words[rand() % 8], rand() % 12, exts[rand() % 4]);
+    } else {
+      // TOSEC style, the names only differ past the sort record key
+      snprintf(b, sizeof(b), "%s (1987)(Ocean Software Ltd)(Hit Squad re-release)(side %c)[a%d].%s", words[rand() % 8], 'A' + rand() % 2, rand() % 20, exts[rand() % 4]);
+    }
+    names.push_back(b);
+  }
+
+  std::vector<hash_item_t> hashes(COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    std::string sfn = short_name(names[i], i);
+    hashes[i].file_id = i;
+    memset(hashes[i].hash, 0, HASH_LEN);
+    memcpy(hashes[i].hash, sfn.c_str(), std::min(sfn.size(), (size_t) HASH_LEN));
+  }
+
+  // string
+  double t = now_ms();
+  std::vector<hash_item_t> v1;
+  for (int r = 0; r < RUNS; r++) {
+    v1 = hashes;
+    std::sort(v1.begin(), v1.end(), [](const hash_item_t &a, const hash_item_t &b) {
+      std::string s1(a.hash, strnlen(a.hash, HASH_LEN)), s2(b.hash, strnlen(b.hash, HASH_LEN));
+      std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
+      std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
+      return s1 < s2;
+    });
+  }
+  double t_string = (now_ms() - t) / RUNS;
+
+  // hash4
+  t = now_ms();
+  std::vector<hash_item_t> v2;
+  for (int r = 0; r < RUNS; r++) {
+    v2 = hashes;
+    std::sort(v2.begin(), v2.end(), [](const hash_item_t &a, const hash_item_t &b) {
+      return strncasecmp(a.hash, b.hash, HASH_LEN) < 0;
+    });
+  }
+  double t_hash = (now_ms() - t) / RUNS;
+
+  // key
+  t = now_ms();
+  std::vector<key_item_t> v3(COUNT);
+  name_reads = 0;
+  for (int r = 0; r < RUNS; r++) {
+    for (size_t i = 0; i < COUNT; i++) {
+      v3[i].file_id = i;
+      collate_key(v3[i].key, KEY_LEN, names[i].c_str());
+    }
+    std::sort(v3.begin(), v3.end(), [](const key_item_t &a, const key_item_t &b) {
+      int c = memcmp(a.key, b.key, KEY_LEN);
+      return c < 0 || (c == 0 && a.file_id < b.file_id);
+    });
+    collate_sort_ties(v3.data(), COUNT, sizeof(key_item_t), nullptr, 0, bench_name, nullptr);
+  }
+  double t_key = (now_ms() - t) / RUNS;
+
+  std::vector<uint16_t> ids1, ids2, ids3;
+  for (auto &i : v1) ids1.push_back(i.file_id);
+  for (auto &i : v2) ids2.push_back(i.file_id);
+  for (auto &i : v3) ids3.push_back(i.file_id);
+
+  printf("%d entries, %d runs\n", COUNT, RUNS);
+  printf("%-8s %10s %12s %14s %12s\n", "sort", "ms/run", "bytes/entry", "out of order", "name reads");
+  printf("%-8s %10.3f %12zu %14d %12d\n", "string", t_string, sizeof(hash_item_t), disorder(ids1), 0);
+  printf("%-8s %10.3f %12zu %14d %12d\n", "hash4", t_hash, sizeof(hash_item_t), disorder(ids2), 0);
+  int key_disorder = disorder(ids3);
+  printf("%-8s %10.3f %12zu %14d %12ld\n", "key", t_key, sizeof(key_item_t), key_disorder, name_reads / RUNS);
+
+  // type-ahead
+  sorted = v3;
+  std::vector<std::vector<uint8_t>> keys;
+  for (auto &i : sorted) {
+    std::vector<uint8_t> k(COLLATE_PREFIX_MAX);
+    collate_key(k.data(), k.size(), names[i.file_id].c_str());
+    keys.push_back(k);
+  }
+  long presses = 0, reads = 0, max_reads = 0, wrong = 0;
+  t = now_ms();
+  for (int i = 0; i < TYPED; i++) {
+    const std::string &name = names[rand() % COUNT];
+    for (size_t len = 1; len <= TYPEAHEAD_LEN && len <= name.size(); len++) {
+      std::string prefix = name.substr(0, len);
+      name_reads = 0;
+      size_t pos = collate_find(prefix.c_str(), bench_seek, nullptr);
+      presses++;
+      reads += name_reads;
+      if (name_reads > max_reads) max_reads = name_reads;
+      if (pos != find_scan(keys, prefix.c_str())) wrong++;
+    }
+  }
+  double t_find = (now_ms() - t) / presses;
+  printf("type-ahead: %ld keypresses, %.2f name reads avg, %ld max, %.3f ms each (scan check included), %ld wrong\n",
+    presses, (double) reads / presses, max_reads, t_find, wrong);
+  return key_disorder == 0 && wrong == 0 ? 0 : 1;
+}